@@ -0,0 +1,67 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+thread_local uint64_t thread_allocation_count = 0;
+
+} // namespace
+
+uint64_t GetThreadAllocationCount() {
+    return thread_allocation_count;
+}
+
+void* operator new(size_t size) {
+    ++thread_allocation_count;
+    while (true) {
+        if (void* pointer = malloc(size == 0 ? 1 : size)) {
+            return pointer;
+        }
+        const new_handler handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    ++thread_allocation_count;
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return operator new(size, nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, const nothrow_t&) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const nothrow_t&) noexcept {
+    free(pointer);
+}
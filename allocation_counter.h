@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of allocations the calling thread has made through the global operator new.
+// allocation_counter.cpp replaces the plain operator new and delete of the whole program
+// with versions that count into a thread-local variable, so counting never contends
+// between threads. Over-aligned allocations are not counted. The library does not depend
+// on it: only programs that link it in and pass it to QueryExecutor::SetAllocationCounter
+// pay for the replacement.
+uint64_t GetThreadAllocationCount();
@@ -0,0 +1,110 @@
+#include "async_search_server.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, chrono::microseconds batch_window,
+    size_t max_batch_size, RequestQueue* request_queue)
+    : search_server_(search_server)
+    , batch_window_(batch_window)
+    , max_batch_size_(max<size_t>(1, max_batch_size))
+    , request_queue_(request_queue)
+    , dispatcher_([this] { Run(); }) {}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    {
+        lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    has_requests_.notify_one();
+    dispatcher_.join();
+}
+
+future<vector<Document>> AsyncSearchServer::FindTopDocuments(string raw_query, DocumentStatus status) {
+    auto promise = make_shared<std::promise<vector<Document>>>();
+    future<vector<Document>> result = promise->get_future();
+    FindTopDocuments(move(raw_query), status, [promise](vector<Document> documents, exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        }
+        else {
+            promise->set_value(move(documents));
+        }
+    });
+    return result;
+}
+
+void AsyncSearchServer::FindTopDocuments(string raw_query, DocumentStatus status, Callback callback) {
+    {
+        lock_guard guard(mutex_);
+        pending_.push_back({ move(raw_query), status, move(callback) });
+    }
+    has_requests_.notify_one();
+}
+
+int AsyncSearchServer::GetNoResultRequests() const {
+    if (request_queue_ == nullptr) {
+        return 0;
+    }
+    lock_guard guard(request_queue_mutex_);
+    return request_queue_->GetNoResultRequests();
+}
+
+void AsyncSearchServer::Run() {
+    for (;;) {
+        {
+            unique_lock lock(mutex_);
+            has_requests_.wait(lock, [this] { return !pending_.empty() || is_stopping_; });
+            if (pending_.empty()) {
+                return;
+            }
+            // Requests arriving shortly after the first one join its batch
+            has_requests_.wait_for(lock, batch_window_, [this] {
+                return pending_.size() >= max_batch_size_ || is_stopping_;
+            });
+            const size_t batch_size = min(pending_.size(), max_batch_size_);
+            batch_.clear();
+            move(pending_.begin(), pending_.begin() + batch_size, back_inserter(batch_));
+            pending_.erase(pending_.begin(), pending_.begin() + batch_size);
+        }
+        ProcessBatch();
+    }
+}
+
+void AsyncSearchServer::ProcessBatch() {
+    if (queries_.size() < batch_.size()) {
+        queries_.resize(batch_.size());
+    }
+    vector<const SearchServer::Query*> queries;
+    vector<DocumentStatus> statuses;
+    vector<exception_ptr> errors(batch_.size());
+    for (size_t index = 0; index < batch_.size(); ++index) {
+        try {
+            search_server_.ParseQuery(batch_[index].raw_query, queries_[index]);
+            queries.push_back(&queries_[index]);
+            statuses.push_back(batch_[index].status);
+        }
+        catch (...) {
+            errors[index] = current_exception();
+        }
+    }
+
+    vector<TopDocuments> top_documents(queries.size(), TopDocuments(MAX_RESULT_DOCUMENT_COUNT));
+    search_server_.FindAllDocumentsBatch(queries, statuses, top_documents);
+
+    size_t query = 0;
+    for (size_t index = 0; index < batch_.size(); ++index) {
+        if (errors[index]) {
+            batch_[index].callback({}, errors[index]);
+            continue;
+        }
+        vector<Document> documents = top_documents[query++].Release();
+        if (request_queue_ != nullptr) {
+            lock_guard guard(request_queue_mutex_);
+            request_queue_->AddFindResult(documents);
+        }
+        batch_[index].callback(move(documents), nullptr);
+    }
+}
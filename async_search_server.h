@@ -0,0 +1,74 @@
+#pragma once
+
+#include "search_server.h"
+#include "request_queue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Accepts queries without blocking the caller. A dispatcher thread collects the requests that
+// arrive within batch_window of the first waiting one, up to max_batch_size, and scores them
+// together so that the postings of a word used by several of them are walked once. Requests
+// complete in submission order. When a RequestQueue is given, the dispatcher records every
+// successful request in it; while the server is alive the queue must be read only through
+// GetNoResultRequests. search_server must not change while requests are pending.
+class AsyncSearchServer {
+public:
+    // Runs on the dispatcher thread and must not throw. error is set for invalid queries.
+    using Callback = std::function<void(std::vector<Document> documents, std::exception_ptr error)>;
+
+    explicit                                AsyncSearchServer(const SearchServer& search_server,
+        std::chrono::microseconds batch_window = std::chrono::microseconds(200),
+        size_t max_batch_size = 16, RequestQueue* request_queue = nullptr);
+
+                                            AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer&                      operator=(const AsyncSearchServer&) = delete;
+
+    // Completes the pending requests, then stops the dispatcher
+                                            ~AsyncSearchServer();
+
+    std::future<std::vector<Document>>      FindTopDocuments(std::string raw_query,
+        DocumentStatus status = DocumentStatus::ACTUAL);
+
+    void                                    FindTopDocuments(std::string raw_query, DocumentStatus status,
+        Callback callback);
+
+    // Of the RequestQueue given to the constructor, 0 without one
+    int                                     GetNoResultRequests() const;
+
+private:
+    struct Request {
+        std::string                         raw_query;
+        DocumentStatus                      status;
+        Callback                            callback;
+    };
+
+    const SearchServer&                     search_server_;
+    std::chrono::microseconds               batch_window_;
+    size_t                                  max_batch_size_;
+    RequestQueue*                           request_queue_;
+    // Guards request_queue_, which is written by the dispatcher thread
+    mutable std::mutex                      request_queue_mutex_;
+
+    std::mutex                              mutex_;
+    std::condition_variable                 has_requests_;
+    std::deque<Request>                     pending_;
+    bool                                    is_stopping_ = false;
+
+    // Only used by the dispatcher thread, reused across batches
+    std::vector<Request>                    batch_;
+    std::vector<SearchServer::Query>        queries_;
+    std::thread                             dispatcher_;
+
+    void                                    Run();
+
+    void                                    ProcessBatch();
+};
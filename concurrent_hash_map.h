@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Concurrent map with integer keys and numeric values over a fixed open-addressing table.
+// Inserting a key claims a slot with a single compare-and-swap; updates are atomic operations
+// on the value and never take a lock. A thread that meets a slot whose key is being published
+// waits only for the few operations of the inserting thread. Keys are never removed, and more
+// than capacity distinct keys throw length_error, also when they are inserted concurrently.
+template <typename Key, typename Value>
+class ConcurrentHashMap {
+private:
+    enum SlotState : uint8_t { EMPTY, BUSY, READY };
+
+    struct Slot {
+        std::atomic<uint8_t> state = EMPTY;
+        // Written once before state becomes READY
+        Key key{};
+        std::atomic<Value> value = Value();
+    };
+
+public:
+    static_assert(std::is_integral_v<Key>, "ConcurrentHashMap supports only integer keys"s);
+    static_assert(std::is_arithmetic_v<Value>, "ConcurrentHashMap supports only numeric values"s);
+
+    // Atomic view of a value. Additions use fetch_add, or a compare-and-swap loop for
+    // floating-point values.
+    class ValueRef {
+    public:
+        explicit ValueRef(std::atomic<Value>& value)
+            : value_(value) {
+        }
+
+        ValueRef& operator+=(Value delta) {
+            if constexpr (std::is_integral_v<Value>) {
+                value_.fetch_add(delta, std::memory_order_relaxed);
+            }
+            else {
+                Value expected = value_.load(std::memory_order_relaxed);
+                while (!value_.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed)) {
+                }
+            }
+            return *this;
+        }
+
+        ValueRef& operator-=(Value delta) {
+            if constexpr (std::is_integral_v<Value>) {
+                value_.fetch_sub(delta, std::memory_order_relaxed);
+                return *this;
+            }
+            else {
+                return *this += -delta;
+            }
+        }
+
+        ValueRef& operator++() {
+            return *this += 1;
+        }
+
+        ValueRef& operator=(Value value) {
+            value_.store(value, std::memory_order_relaxed);
+            return *this;
+        }
+
+        operator Value() const {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<Value>& value_;
+    };
+
+    struct Access {
+        ValueRef ref_to_value;
+    };
+
+    // Iterates over the keys inserted so far without blocking writers. Values are read when
+    // the iterator is dereferenced, so concurrent updates may or may not be seen.
+    class ConstIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<Key, Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        ConstIterator(const Slot* slot, const Slot* end)
+            : slot_(slot)
+            , end_(end) {
+            SkipUnready();
+        }
+
+        value_type operator*() const {
+            return { slot_->key, slot_->value.load(std::memory_order_relaxed) };
+        }
+
+        ConstIterator& operator++() {
+            ++slot_;
+            SkipUnready();
+            return *this;
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return slot_ == other.slot_;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return slot_ != other.slot_;
+        }
+
+    private:
+        const Slot* slot_;
+        const Slot* end_;
+
+        void SkipUnready() {
+            while (slot_ != end_ && slot_->state.load(std::memory_order_acquire) != READY) {
+                ++slot_;
+            }
+        }
+    };
+
+    // The table is kept at most half full
+    explicit ConcurrentHashMap(size_t capacity)
+        : slots_(GetTableSize(capacity))
+        , capacity_(capacity) {
+    }
+
+    Access operator[](const Key& key) {
+        return { ValueRef(FindOrInsert(key).value) };
+    }
+
+    ConstIterator begin() const {
+        return { slots_.data(), slots_.data() + slots_.size() };
+    }
+
+    ConstIterator end() const {
+        return { slots_.data() + slots_.size(), slots_.data() + slots_.size() };
+    }
+
+    size_t size() const {
+        // An insert that does not fit counts itself for a moment before giving its slot back
+        return std::min(size_.load(std::memory_order_relaxed), capacity_);
+    }
+
+    std::map<Key, Value> BuildOrdinaryMap() const {
+        std::map<Key, Value> result;
+        for (const auto [key, value] : *this) {
+            result.emplace(key, value);
+        }
+        return result;
+    }
+
+private:
+    std::vector<Slot> slots_;
+    size_t capacity_;
+    std::atomic<size_t> size_ = 0;
+
+    static size_t GetTableSize(size_t capacity) {
+        size_t table_size = 1;
+        while (table_size < capacity * 2) {
+            table_size *= 2;
+        }
+        return table_size;
+    }
+
+    // Scatters consecutive and otherwise clustered keys over the table
+    static uint64_t Hash(const Key& key) {
+        uint64_t hash = static_cast<uint64_t>(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    Slot& FindOrInsert(const Key& key) {
+        const size_t mask = slots_.size() - 1;
+        size_t index = Hash(key) & mask;
+        for (size_t probe = 0; probe < slots_.size();) {
+            Slot& slot = slots_[index];
+            uint8_t state = slot.state.load(std::memory_order_acquire);
+            if (state == EMPTY && slot.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire)) {
+                // The slot is claimed first and counted second, so a key that does not fit
+                // gives its slot back instead of being published
+                if (size_.fetch_add(1, std::memory_order_relaxed) >= capacity_) {
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                    slot.state.store(EMPTY, std::memory_order_release);
+                    throw std::length_error("ConcurrentHashMap is full"s);
+                }
+                slot.key = key;
+                slot.state.store(READY, std::memory_order_release);
+                return slot;
+            }
+            while (state == BUSY) {
+                std::this_thread::yield();
+                state = slot.state.load(std::memory_order_acquire);
+            }
+            // A slot given back is tried again
+            if (state == READY) {
+                if (slot.key == key) {
+                    return slot;
+                }
+                ++probe;
+                index = (index + 1) & mask;
+            }
+        }
+        throw std::length_error("ConcurrentHashMap is full"s);
+    }
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
+#include <vector>
 using namespace std;
 struct Document {
     Document() = default;
@@ -20,3 +22,9 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+struct RawDocument {
+    int                 id = 0;
+    std::string_view    text;
+    DocumentStatus      status = DocumentStatus::ACTUAL;
+    std::vector<int>    ratings;
+};
@@ -0,0 +1,127 @@
+#include "document_loader.h"
+
+#include <charconv>
+#include <cstring>
+#include <execution>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+string_view TakeField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == line.npos) {
+        throw invalid_argument("Missing field"s);
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseInt(string_view str) {
+    int value = 0;
+    const auto [end, error] = from_chars(str.data(), str.data() + str.size(), value);
+    if (error != errc() || end != str.data() + str.size() || str.empty()) {
+        throw invalid_argument("Invalid number "s + string(str));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view str) {
+    if (str == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (str == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (str == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (str == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("Invalid status "s + string(str));
+}
+
+} // namespace
+
+DocumentFileReader::DocumentFileReader(const string& path)
+    : file_(path) {
+}
+
+bool DocumentFileReader::ReadBatch(vector<RawDocument>& batch, size_t max_count) {
+    // Texts of the previous batch are no longer referenced
+    file_.Release(pos_);
+
+    const char* data = file_.data();
+    const size_t size = file_.size();
+    size_t count = 0;
+    while (count < max_count && pos_ < size) {
+        const char* line_end = static_cast<const char*>(memchr(data + pos_, '\n', size - pos_));
+        const size_t end = line_end == nullptr ? size : line_end - data;
+        string_view line(data + pos_, end - pos_);
+        pos_ = line_end == nullptr ? size : end + 1;
+        ++line_number_;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (count == batch.size()) {
+            batch.emplace_back();
+        }
+        try {
+            ParseLine(line, batch[count]);
+        }
+        catch (const invalid_argument& e) {
+            throw invalid_argument("Line "s + to_string(line_number_) + ": "s + e.what());
+        }
+        ++count;
+    }
+    batch.resize(count);
+    return count > 0;
+}
+
+size_t DocumentFileReader::GetBytesRead() const {
+    return pos_;
+}
+
+size_t DocumentFileReader::GetFileSize() const {
+    return file_.size();
+}
+
+void DocumentFileReader::ParseLine(string_view line, RawDocument& document) const {
+    document.id = ParseInt(TakeField(line));
+    document.status = ParseStatus(TakeField(line));
+    string_view ratings = TakeField(line);
+    document.ratings.clear();
+    while (!ratings.empty()) {
+        const size_t space = ratings.find(' ');
+        const string_view rating = ratings.substr(0, space);
+        if (!rating.empty()) {
+            document.ratings.push_back(ParseInt(rating));
+        }
+        ratings.remove_prefix(space == ratings.npos ? ratings.size() : space + 1);
+    }
+    document.text = line;
+}
+
+DocumentLoadStats LoadDocuments(SearchServer& search_server, const string& path, size_t batch_size) {
+    if (batch_size == 0) {
+        throw invalid_argument("Batch size must be positive"s);
+    }
+    DocumentFileReader reader(path);
+    DocumentLoadStats stats;
+    vector<RawDocument> batch;
+    batch.reserve(batch_size);
+    while (reader.ReadBatch(batch, batch_size)) {
+        search_server.AddDocuments(execution::par, batch);
+        stats.document_count += batch.size();
+        ++stats.batch_count;
+    }
+    stats.byte_count = reader.GetBytesRead();
+    return stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "document.h"
+#include "mapped_file.h"
+#include "search_server.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads a document file one batch at a time straight from the mapped file. Each line is
+//     id \t status \t ratings separated by spaces \t text
+// where status is ACTUAL, IRRELEVANT, BANNED or REMOVED; empty lines are skipped. Texts of a
+// batch point into the mapping and stay valid until the next batch is read, when the pages
+// of the previous ones are given back to the system.
+class DocumentFileReader {
+public:
+    explicit DocumentFileReader(const std::string& path);
+
+    // Fills the batch with up to max_count documents, reusing its elements. Returns false
+    // once the file is exhausted. Throws invalid_argument for malformed lines.
+    bool                                    ReadBatch(std::vector<RawDocument>& batch, size_t max_count);
+
+    size_t                                  GetBytesRead() const;
+
+    size_t                                  GetFileSize() const;
+
+private:
+    MappedFile                              file_;
+    size_t                                  pos_ = 0;
+    size_t                                  line_number_ = 0;
+
+    void                                    ParseLine(std::string_view line, RawDocument& document) const;
+};
+
+struct DocumentLoadStats {
+    size_t          document_count = 0;
+    size_t          byte_count = 0;
+    size_t          batch_count = 0;
+};
+
+// Adds every document of the file in batches of batch_size, tokenizing each batch in parallel.
+// Memory is bounded by one batch of metadata; only the words new to the index are copied.
+// The file is not validated up front: if a line is malformed or a batch is rejected by
+// AddDocuments, invalid_argument is thrown, the batches before it stay added and the failing
+// one is not added. Throws invalid_argument if batch_size is 0.
+DocumentLoadStats LoadDocuments(SearchServer& search_server, const std::string& path, size_t batch_size = 4096);
@@ -0,0 +1,169 @@
+#include "document_store.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+DocumentStore::Iterator::Iterator(const DocumentStore* store, size_t dense_id, map<int, int>::const_iterator sparse_it)
+    : store_(store)
+    , dense_id_(dense_id)
+    , sparse_it_(sparse_it) {
+    SkipAbsent();
+}
+
+const int& DocumentStore::Iterator::operator*() const {
+    return id_;
+}
+
+DocumentStore::Iterator& DocumentStore::Iterator::operator++() {
+    if (dense_id_ < store_->dense_ordinals_.size()) {
+        ++dense_id_;
+    }
+    else {
+        ++sparse_it_;
+    }
+    SkipAbsent();
+    return *this;
+}
+
+bool DocumentStore::Iterator::operator==(const Iterator& other) const {
+    return dense_id_ == other.dense_id_ && sparse_it_ == other.sparse_it_;
+}
+
+bool DocumentStore::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+void DocumentStore::Iterator::SkipAbsent() {
+    const vector<int>& dense_ordinals = store_->dense_ordinals_;
+    while (dense_id_ < dense_ordinals.size() && dense_ordinals[dense_id_] < 0) {
+        ++dense_id_;
+    }
+    if (dense_id_ < dense_ordinals.size()) {
+        id_ = static_cast<int>(dense_id_);
+    }
+    else if (sparse_it_ != store_->sparse_ordinals_.end()) {
+        id_ = sparse_it_->first;
+    }
+}
+
+int DocumentStore::Add(int document_id, DocumentStatus status, int rating) {
+    const int ordinal = static_cast<int>(ids_.size());
+    ids_.push_back(document_id);
+    statuses_.push_back(status);
+    ratings_.push_back(rating);
+    ++size_;
+    AddOrdinal(document_id, ordinal);
+    return ordinal;
+}
+
+int DocumentStore::Remove(int document_id) {
+    int ordinal;
+    if (static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+        ordinal = exchange(dense_ordinals_[document_id], -1);
+    }
+    else {
+        const auto it = sparse_ordinals_.find(document_id);
+        ordinal = it->second;
+        sparse_ordinals_.erase(it);
+    }
+    ids_.MutableData()[ordinal] = -1;
+    --size_;
+    return ordinal;
+}
+
+void DocumentStore::Reserve(size_t document_count) {
+    ids_.reserve(document_count);
+    statuses_.reserve(document_count);
+    ratings_.reserve(document_count);
+}
+
+bool DocumentStore::AssignView(const int* ids, const DocumentStatus* statuses, const int* ratings, size_t count) {
+    ids_.AssignView(ids, count);
+    for (size_t ordinal = 0; ordinal < count; ++ordinal) {
+        const int document_id = ids[ordinal];
+        const int status = static_cast<int>(statuses[ordinal]);
+        if (document_id < 0 || Contains(document_id)
+            || status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED)) {
+            *this = DocumentStore();
+            return false;
+        }
+        AddOrdinal(document_id, static_cast<int>(ordinal));
+    }
+    statuses_.AssignView(statuses, count);
+    ratings_.AssignView(ratings, count);
+    size_ = count;
+    return true;
+}
+
+void DocumentStore::Detach() {
+    ids_.Detach();
+    statuses_.Detach();
+    ratings_.Detach();
+}
+
+int DocumentStore::FindOrdinal(int document_id) const {
+    if (document_id < 0) {
+        return -1;
+    }
+    if (static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+        return dense_ordinals_[document_id];
+    }
+    const auto it = sparse_ordinals_.find(document_id);
+    return it == sparse_ordinals_.end() ? -1 : it->second;
+}
+
+int DocumentStore::GetOrdinal(int document_id) const {
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal < 0) {
+        throw out_of_range("Document out of range"s);
+    }
+    return ordinal;
+}
+
+bool DocumentStore::Contains(int document_id) const {
+    return FindOrdinal(document_id) >= 0;
+}
+
+size_t DocumentStore::GetMemoryUsage() const {
+    const size_t tree_node_overhead = 4 * sizeof(void*);
+    return ids_.GetMemoryUsage()
+        + statuses_.GetMemoryUsage()
+        + ratings_.GetMemoryUsage()
+        + dense_ordinals_.capacity() * sizeof(int)
+        + sparse_ordinals_.size() * (tree_node_overhead + sizeof(pair<const int, int>));
+}
+
+DocumentStore::Iterator DocumentStore::begin() const {
+    return { this, 0, sparse_ordinals_.begin() };
+}
+
+DocumentStore::Iterator DocumentStore::end() const {
+    return { this, dense_ordinals_.size(), sparse_ordinals_.end() };
+}
+
+void DocumentStore::GrowDenseOrdinals(int document_id) {
+    const size_t id = static_cast<size_t>(document_id);
+    // The array stays within a few ints per document however the ids are spread
+    const size_t max_size = max(MIN_DENSE_SIZE, 2 * ids_.size());
+    if (id < dense_ordinals_.size() || id >= max_size) {
+        return;
+    }
+    dense_ordinals_.resize(max(id + 1, min(max_size, 2 * dense_ordinals_.size())), -1);
+    while (!sparse_ordinals_.empty() && static_cast<size_t>(sparse_ordinals_.begin()->first) < dense_ordinals_.size()) {
+        dense_ordinals_[sparse_ordinals_.begin()->first] = sparse_ordinals_.begin()->second;
+        sparse_ordinals_.erase(sparse_ordinals_.begin());
+    }
+}
+
+void DocumentStore::AddOrdinal(int document_id, int ordinal) {
+    GrowDenseOrdinals(document_id);
+    if (static_cast<size_t>(document_id) < dense_ordinals_.size()) {
+        dense_ordinals_[document_id] = ordinal;
+    }
+    else {
+        sparse_ordinals_.emplace(document_id, ordinal);
+    }
+}
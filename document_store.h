@@ -0,0 +1,139 @@
+#pragma once
+
+#include "document.h"
+#include "mappable_array.h"
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// Metadata of the documents of one index in columns indexed by ordinal. Ordinals are given out
+// in insertion order and never reused; a removed document keeps its slot with id -1.
+// Ids map to ordinals through an array indexed by id while ids are about as dense as ordinals;
+// larger ids go to a tree. Iteration visits the ids of live documents in ascending order.
+// The columns can be views of a mapped index file.
+class DocumentStore {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        Iterator(const DocumentStore* store, size_t dense_id, std::map<int, int>::const_iterator sparse_it);
+
+        const int&                          operator*() const;
+
+        Iterator&                           operator++();
+
+        bool                                operator==(const Iterator& other) const;
+
+        bool                                operator!=(const Iterator& other) const;
+
+    private:
+        const DocumentStore*                store_;
+        // Id being visited in the dense array, its size once the tree is reached
+        size_t                              dense_id_;
+        std::map<int, int>::const_iterator  sparse_it_;
+        int                                 id_ = 0;
+
+        void                                SkipAbsent();
+    };
+
+    // Returns the ordinal given to the document; the id must not be in the store
+    int                                     Add(int document_id, DocumentStatus status, int rating);
+
+    // Returns the ordinal of the removed document
+    int                                     Remove(int document_id);
+
+    void                                    Reserve(size_t document_count);
+
+    // Views columns owned by someone else instead of copying them; only the id to ordinal
+    // mapping is built. The store must be empty. Returns false, leaving it empty, if an id
+    // is negative or repeated or a status is not a DocumentStatus.
+    bool                                    AssignView(const int* ids, const DocumentStatus* statuses,
+                                                const int* ratings, size_t count);
+
+    // Copies viewed columns into storage owned by the store
+    void                                    Detach();
+
+    // -1 for unknown ids
+    int                                     FindOrdinal(int document_id) const;
+
+    // Throws out_of_range for unknown ids
+    int                                     GetOrdinal(int document_id) const;
+
+    bool                                    Contains(int document_id) const;
+
+    // Number of live documents
+    size_t                                  size() const;
+
+    bool                                    empty() const;
+
+    // Number of ordinals given out, including removed documents
+    size_t                                  GetOrdinalCount() const;
+
+    // -1 for removed documents
+    int                                     GetDocumentId(int ordinal) const;
+
+    DocumentStatus                          GetStatus(int ordinal) const;
+
+    int                                     GetRating(int ordinal) const;
+
+    bool                                    IsRemoved(int ordinal) const;
+
+    size_t                                  GetMemoryUsage() const;
+
+    Iterator                                begin() const;
+
+    Iterator                                end() const;
+
+private:
+    // Ids below this bound always use the dense array
+    static constexpr size_t                 MIN_DENSE_SIZE = 1024;
+
+    MappableArray<int>                      ids_;
+    MappableArray<DocumentStatus>           statuses_;
+    MappableArray<int>                      ratings_;
+    size_t                                  size_ = 0;
+
+    // Ordinal by id, -1 for absent ids
+    std::vector<int>                        dense_ordinals_;
+    // Ids not covered by dense_ordinals_, so all of them are larger than its size
+    std::map<int, int>                      sparse_ordinals_;
+
+    void                                    GrowDenseOrdinals(int document_id);
+
+    void                                    AddOrdinal(int document_id, int ordinal);
+};
+
+inline size_t DocumentStore::size() const {
+    return size_;
+}
+
+inline bool DocumentStore::empty() const {
+    return size_ == 0;
+}
+
+inline size_t DocumentStore::GetOrdinalCount() const {
+    return ids_.size();
+}
+
+inline int DocumentStore::GetDocumentId(int ordinal) const {
+    return ids_[ordinal];
+}
+
+inline DocumentStatus DocumentStore::GetStatus(int ordinal) const {
+    return statuses_[ordinal];
+}
+
+inline int DocumentStore::GetRating(int ordinal) const {
+    return ratings_[ordinal];
+}
+
+inline bool DocumentStore::IsRemoved(int ordinal) const {
+    return ids_[ordinal] < 0;
+}
@@ -0,0 +1,374 @@
+#include "index_file.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const char INDEX_FILE_MAGIC[4] = { 'S', 'S', 'I', 'X' };
+const uint32_t INDEX_FILE_VERSION = 2;
+const uint32_t INDEX_FILE_COMPRESSED_POSTINGS = 1;
+
+// Arrays are read back as views of the mapped file, so they are saved in the layout the
+// process uses in memory
+static_assert(sizeof(int) == sizeof(int32_t) && sizeof(DocumentStatus) == sizeof(int32_t));
+static_assert(sizeof(Posting) == 16 && offsetof(Posting, ordinal) == 0 && offsetof(Posting, term_freq) == 8);
+static_assert(sizeof(PostingList::Block) == 8);
+
+class IndexWriter {
+public:
+    explicit IndexWriter(const string& path)
+        : out_(path, ios::binary) {
+        if (!out_) {
+            throw runtime_error("Cannot open index file "s + path);
+        }
+    }
+
+    template <typename Value>
+    void Write(Value value) {
+        WriteBytes(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void WriteString(string_view str) {
+        Write(static_cast<uint32_t>(str.size()));
+        WriteBytes(str.data(), str.size());
+    }
+
+    void WriteBytes(const char* data, size_t size) {
+        out_.write(data, size);
+        pos_ += size;
+    }
+
+    // Pads with zeros up to the next offset divisible by alignment
+    void Align(size_t alignment) {
+        while (pos_ % alignment != 0) {
+            Write('\0');
+        }
+    }
+
+    void Finish() {
+        out_.flush();
+        if (!out_) {
+            throw runtime_error("Failed to write index file"s);
+        }
+    }
+
+private:
+    ofstream out_;
+    size_t pos_ = 0;
+};
+
+class IndexReader {
+public:
+    IndexReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {}
+
+    template <typename Value>
+    Value Read() {
+        Value value;
+        memcpy(&value, Take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    string_view ReadString() {
+        const uint32_t size = Read<uint32_t>();
+        return { Take(size), size };
+    }
+
+    // Reads the number of the items that follow. Every item takes at least min_item_size bytes,
+    // so a count the rest of the file can not hold is rejected before anything is allocated for it.
+    uint32_t ReadCount(size_t min_item_size) {
+        const uint32_t count = Read<uint32_t>();
+        if ((size_ - pos_) / min_item_size < count) {
+            throw runtime_error("Index file is corrupted"s);
+        }
+        return count;
+    }
+
+    // The array stays in the file. The file starts at a page or allocation boundary, so an
+    // aligned offset gives an aligned address.
+    template <typename Value>
+    const Value* ReadArray(size_t count) {
+        while (pos_ % alignof(Value) != 0) {
+            Take(1);
+        }
+        if ((size_ - pos_) / sizeof(Value) < count) {
+            throw runtime_error("Index file is truncated"s);
+        }
+        return reinterpret_cast<const Value*>(Take(count * sizeof(Value)));
+    }
+
+    bool AtEnd() const {
+        return pos_ == size_;
+    }
+
+    const char* Take(size_t size) {
+        if (size_ - pos_ < size) {
+            throw runtime_error("Index file is truncated"s);
+        }
+        const char* result = data_ + pos_;
+        pos_ += size;
+        return result;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+void SaveIndex(const SearchServer& search_server, const string& path) {
+    IndexWriter writer(path);
+    writer.WriteBytes(INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC));
+    writer.Write(INDEX_FILE_VERSION);
+    const bool is_compressed = search_server.options_.compress_postings;
+    writer.Write(is_compressed ? INDEX_FILE_COMPRESSED_POSTINGS : uint32_t{ 0 });
+
+    writer.Write(static_cast<uint32_t>(search_server.stop_words_.size()));
+    for (const string_view stop_word : search_server.stop_words_) {
+        writer.WriteString(stop_word);
+    }
+
+    // Ordinals of removed documents are dropped, live documents are renumbered densely
+    const DocumentStore& documents = search_server.documents_;
+    vector<int> new_ordinals(documents.GetOrdinalCount(), -1);
+    vector<size_t> live_ordinals;
+    for (size_t ordinal = 0; ordinal < documents.GetOrdinalCount(); ++ordinal) {
+        if (!documents.IsRemoved(ordinal)) {
+            new_ordinals[ordinal] = static_cast<int>(live_ordinals.size());
+            live_ordinals.push_back(ordinal);
+        }
+    }
+
+    writer.Write(static_cast<uint32_t>(live_ordinals.size()));
+    writer.Align(alignof(int32_t));
+    for (const size_t ordinal : live_ordinals) {
+        writer.Write(static_cast<int32_t>(documents.GetDocumentId(ordinal)));
+    }
+    for (const size_t ordinal : live_ordinals) {
+        writer.Write(static_cast<int32_t>(documents.GetRating(ordinal)));
+    }
+    for (const size_t ordinal : live_ordinals) {
+        writer.Write(static_cast<int32_t>(documents.GetStatus(ordinal)));
+    }
+
+    // Terms are written in word order, which lets the loader build forward index maps by appending
+    vector<pair<string_view, size_t>> terms;
+    for (const auto& [word, term_id] : search_server.word_to_term_id_) {
+        const auto& term = search_server.terms_[term_id];
+        if (term.postings.size() > term.removed_postings) {
+            terms.push_back({ word, term_id });
+        }
+    }
+    sort(terms.begin(), terms.end());
+    writer.Write(static_cast<uint32_t>(terms.size()));
+    vector<uint64_t> document_term_offsets(live_ordinals.size() + 1, 0);
+    for (const auto& [word, term_id] : terms) {
+        // Lists are rebuilt over the new ordinals in the representation they are saved in
+        PostingList postings(is_compressed);
+        search_server.terms_[term_id].postings.ForEach([&](int ordinal, double term_freq) {
+            if (new_ordinals[ordinal] >= 0) {
+                postings.Append(new_ordinals[ordinal], term_freq);
+                ++document_term_offsets[new_ordinals[ordinal] + 1];
+            }
+        });
+        writer.WriteString(word);
+        writer.Write(static_cast<uint32_t>(postings.size()));
+        if (!is_compressed) {
+            writer.Align(alignof(Posting));
+            for (const Posting& posting : postings.postings_) {
+                writer.Write(static_cast<int32_t>(posting.ordinal));
+                writer.Write(uint32_t{ 0 });
+                writer.Write(posting.term_freq);
+            }
+        }
+        else {
+            writer.Write(static_cast<uint32_t>(postings.blocks_.size()));
+            writer.Write(static_cast<uint32_t>(postings.bytes_.size()));
+            writer.Align(alignof(PostingList::Block));
+            writer.WriteBytes(reinterpret_cast<const char*>(postings.blocks_.data()),
+                postings.blocks_.size() * sizeof(PostingList::Block));
+            writer.WriteBytes(reinterpret_cast<const char*>(postings.bytes_.data()), postings.bytes_.size());
+        }
+    }
+
+    // Forward index as in COMPACT mode; terms come in word order, so the ids of every
+    // document come out sorted
+    partial_sum(document_term_offsets.begin(), document_term_offsets.end(), document_term_offsets.begin());
+    vector<uint32_t> document_term_ids(document_term_offsets.back());
+    vector<uint64_t> positions(document_term_offsets.begin(), document_term_offsets.end() - 1);
+    for (size_t new_term_id = 0; new_term_id < terms.size(); ++new_term_id) {
+        search_server.terms_[terms[new_term_id].second].postings.ForEach([&](int ordinal, double) {
+            if (new_ordinals[ordinal] >= 0) {
+                document_term_ids[positions[new_ordinals[ordinal]]++] = static_cast<uint32_t>(new_term_id);
+            }
+        });
+    }
+    writer.Align(alignof(uint64_t));
+    writer.WriteBytes(reinterpret_cast<const char*>(document_term_offsets.data()),
+        document_term_offsets.size() * sizeof(uint64_t));
+    writer.WriteBytes(reinterpret_cast<const char*>(document_term_ids.data()),
+        document_term_ids.size() * sizeof(uint32_t));
+    writer.Finish();
+}
+
+SearchServer LoadIndex(const string& path, const SearchServerOptions& options, IndexLoadMode mode) {
+    const bool is_view = mode == IndexLoadMode::VIEW;
+    // A viewed file is read in query order later, so it is not mapped for sequential reading
+    const auto file = make_shared<const MappedFile>(path, !is_view);
+    IndexReader reader(file->data(), file->size());
+
+    if (memcmp(reader.Take(sizeof(INDEX_FILE_MAGIC)), INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)) != 0) {
+        throw runtime_error("Not an index file: "s + path);
+    }
+    if (reader.Read<uint32_t>() != INDEX_FILE_VERSION) {
+        throw runtime_error("Unsupported index file version: "s + path);
+    }
+
+    // Counts, ids, statuses, the word order and every posting are checked before they are
+    // used, so a damaged file raises runtime_error rather than breaking the index
+    const auto check = [&path](bool is_valid) {
+        if (!is_valid) {
+            throw runtime_error("Index file is corrupted: "s + path);
+        }
+    };
+
+    const uint32_t flags = reader.Read<uint32_t>();
+    check((flags & ~INDEX_FILE_COMPRESSED_POSTINGS) == 0);
+    const bool is_compressed = (flags & INDEX_FILE_COMPRESSED_POSTINGS) != 0;
+
+    vector<string_view> stop_words(reader.ReadCount(sizeof(uint32_t)));
+    for (string_view& stop_word : stop_words) {
+        stop_word = reader.ReadString();
+        check(SearchServer::IsValidWord(stop_word));
+    }
+    SearchServer search_server(stop_words, options);
+
+    const uint32_t document_count = reader.ReadCount(3 * sizeof(int32_t));
+    const int* ids = reader.ReadArray<int>(document_count);
+    const int* ratings = reader.ReadArray<int>(document_count);
+    const DocumentStatus* statuses = reader.ReadArray<DocumentStatus>(document_count);
+    check(search_server.documents_.AssignView(ids, statuses, ratings, document_count));
+
+    // A term takes at least its word size and posting count
+    const uint32_t term_count = reader.ReadCount(2 * sizeof(uint32_t));
+    search_server.terms_.reserve(term_count);
+    search_server.word_to_term_id_.reserve(term_count);
+    vector<string_view> term_words;
+    term_words.reserve(term_count);
+    string_view previous_word;
+    for (uint32_t term_id = 0; term_id < term_count; ++term_id) {
+        // Words are strictly ascending, so every word gets the next term id
+        const string_view file_word = reader.ReadString();
+        check(!file_word.empty() && (term_id == 0 || previous_word < file_word) && SearchServer::IsValidWord(file_word));
+        previous_word = file_word;
+        const string_view word = search_server.InternWord(file_word);
+        term_words.push_back(word);
+        SearchServer::Term& term = search_server.terms_[search_server.GetOrAddTermId(word)];
+
+        // Every posting takes at least its 16-bit term frequency
+        const uint32_t posting_count = reader.ReadCount(sizeof(uint16_t));
+        PostingList file_postings;
+        if (!is_compressed) {
+            const Posting* postings = reader.ReadArray<Posting>(posting_count);
+            check(file_postings.AssignView(postings, posting_count, static_cast<int>(document_count)));
+        }
+        else {
+            const uint32_t block_count = reader.ReadCount(sizeof(PostingList::Block));
+            const uint32_t byte_count = reader.ReadCount(sizeof(uint8_t));
+            const PostingList::Block* blocks = reader.ReadArray<PostingList::Block>(block_count);
+            const uint8_t* bytes = reader.ReadArray<uint8_t>(byte_count);
+            check(file_postings.AssignView(posting_count, bytes, byte_count, blocks, block_count,
+                static_cast<int>(document_count)));
+        }
+        if (file_postings.IsCompressed() == options.compress_postings) {
+            term.postings = move(file_postings);
+        }
+        else {
+            file_postings.ForEach([&term](int ordinal, double term_freq) {
+                term.postings.Append(ordinal, term_freq);
+            });
+        }
+        SearchServer::UpdateLogDocumentFreq(term);
+    }
+    search_server.UpdateLogDocumentCount();
+
+    const uint64_t* term_offsets = reader.ReadArray<uint64_t>(size_t{ document_count } + 1);
+    check(term_offsets[0] == 0);
+    for (uint32_t ordinal = 0; ordinal < document_count; ++ordinal) {
+        check(term_offsets[ordinal] <= term_offsets[ordinal + 1]);
+    }
+    const uint32_t* term_ids = reader.ReadArray<uint32_t>(term_offsets[document_count]);
+    check(reader.AtEnd());
+
+    // Number of postings of every document, shifted by one ordinal. 32-bit counts keep the
+    // array small enough for the cache while it is updated in posting order.
+    vector<uint32_t> document_word_counts;
+    if (options.forward_index != ForwardIndexMode::NONE) {
+        document_word_counts.assign(size_t{ document_count } + 1, 0);
+        for (const SearchServer::Term& term : search_server.terms_) {
+            term.postings.ForEach([&document_word_counts](int ordinal, double) {
+                ++document_word_counts[ordinal + 1];
+            });
+        }
+    }
+    switch (options.forward_index) {
+    case ForwardIndexMode::MAP: {
+        // Group postings by document; terms come in word order, so every group is already sorted
+        vector<size_t> word_offsets(document_word_counts.size());
+        partial_sum(document_word_counts.begin(), document_word_counts.end(), word_offsets.begin(), plus<size_t>());
+        vector<size_t> positions(word_offsets.begin(), word_offsets.end() - 1);
+        vector<pair<string_view, double>> document_words(word_offsets.back());
+        for (uint32_t term_id = 0; term_id < term_count; ++term_id) {
+            search_server.terms_[term_id].postings.ForEach([&](int ordinal, double term_freq) {
+                document_words[positions[ordinal]++] = { term_words[term_id], term_freq };
+            });
+        }
+        for (uint32_t ordinal = 0; ordinal < document_count; ++ordinal) {
+            auto& word_freqs = search_server.document_to_word_freqs_[search_server.documents_.GetDocumentId(ordinal)];
+            for (size_t i = word_offsets[ordinal]; i < word_offsets[ordinal + 1]; ++i) {
+                word_freqs.emplace_hint(word_freqs.end(), document_words[i]);
+            }
+        }
+        break;
+    }
+    case ForwardIndexMode::COMPACT:
+        // The saved term ids must be sorted, in range and as many as the postings of the document
+        for (uint32_t ordinal = 0; ordinal < document_count; ++ordinal) {
+            check(term_offsets[ordinal + 1] - term_offsets[ordinal] == document_word_counts[ordinal + 1]);
+            for (uint64_t i = term_offsets[ordinal]; i < term_offsets[ordinal + 1]; ++i) {
+                check(term_ids[i] < term_count && (i == term_offsets[ordinal] || term_ids[i - 1] < term_ids[i]));
+            }
+        }
+        search_server.document_term_ids_.AssignView(term_ids, term_offsets[document_count]);
+        search_server.document_term_offsets_.AssignView(term_offsets, size_t{ document_count } + 1);
+        break;
+    case ForwardIndexMode::NONE:
+        break;
+    }
+
+    if (is_view) {
+        search_server.mapped_file_ = file;
+    }
+    else {
+        search_server.documents_.Detach();
+        for (SearchServer::Term& term : search_server.terms_) {
+            term.postings.Detach();
+        }
+        search_server.document_term_ids_.Detach();
+        search_server.document_term_offsets_.Detach();
+    }
+    return search_server;
+}
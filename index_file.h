@@ -0,0 +1,26 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <string>
+
+enum class IndexLoadMode {
+    // Posting lists, document columns and the forward index are copied to the heap and the
+    // file is closed. Loading is linear in the number of postings.
+    COPY,
+    // They stay in the mapped file and the server serves queries from it; the mapping lives
+    // as long as the server and its copies. Only the term dictionary and the id to ordinal
+    // mapping are built. Postings saved flat and loaded with compressed ones, or the other
+    // way around, are reencoded to the heap, and a MAP forward index is always built.
+    VIEW,
+};
+
+// Binary index file: stop words, document metadata, the term dictionary with posting lists
+// and the forward index as sorted term ids per document. Arrays are stored aligned, in the
+// layout and byte order of the machine that saved them, so loading never tokenizes text.
+void SaveIndex(const SearchServer& search_server, const std::string& path);
+
+// Throws runtime_error for files that are truncated, of another version or inconsistent.
+// Every posting is checked in both modes.
+SearchServer LoadIndex(const std::string& path, const SearchServerOptions& options = {},
+    IndexLoadMode mode = IndexLoadMode::COPY);
@@ -0,0 +1,58 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void LatencyHistogram::Add(chrono::nanoseconds latency) {
+    const uint64_t microseconds = static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::microseconds>(latency).count()));
+    buckets_[GetBucket(microseconds)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(memory_order_relaxed);
+}
+
+chrono::microseconds LatencyHistogram::GetPercentile(double fraction) const {
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * GetCount())));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += buckets_[bucket].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return chrono::microseconds(GetBucketUpperBound(bucket));
+        }
+    }
+    return chrono::microseconds(0);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t microseconds) {
+    if (microseconds < LINEAR_BUCKET_COUNT) {
+        return static_cast<size_t>(microseconds);
+    }
+    int exponent = 0;
+    while ((microseconds >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+    // The three bits below the leading one select the sub-bucket
+    const uint64_t sub_bucket = (microseconds >> (exponent - 3)) & (SUB_BUCKET_COUNT - 1);
+    return LINEAR_BUCKET_COUNT + (exponent - 4) * SUB_BUCKET_COUNT + static_cast<size_t>(sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+    if (bucket < LINEAR_BUCKET_COUNT) {
+        return bucket;
+    }
+    const size_t exponent = (bucket - LINEAR_BUCKET_COUNT) / SUB_BUCKET_COUNT + 4;
+    const uint64_t sub_bucket = (bucket - LINEAR_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+    const uint64_t width = uint64_t{ 1 } << (exponent - 3);
+    return (SUB_BUCKET_COUNT + sub_bucket) * width + width - 1;
+}
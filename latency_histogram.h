@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Latencies counted in buckets 1 us wide below 16 us and 1/8 of a power of two wide above,
+// so percentiles are accurate to 12.5% in constant memory. Add is lock-free and may be
+// called from any thread.
+class LatencyHistogram {
+public:
+    void                                                Add(std::chrono::nanoseconds latency);
+
+    uint64_t                                            GetCount() const;
+
+    // Upper bound of the bucket holding the given fraction (0, 1] of the recorded latencies
+    std::chrono::microseconds                           GetPercentile(double fraction) const;
+
+    void                                                Reset();
+
+private:
+    static const size_t                                 LINEAR_BUCKET_COUNT = 16;
+    static const size_t                                 SUB_BUCKET_COUNT = 8;
+    static const size_t                                 BUCKET_COUNT = LINEAR_BUCKET_COUNT + SUB_BUCKET_COUNT * 60;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT>     buckets_ = {};
+    std::atomic<uint64_t>                               count_ = 0;
+
+    static size_t                                       GetBucket(uint64_t microseconds);
+
+    static uint64_t                                     GetBucketUpperBound(size_t bucket);
+};
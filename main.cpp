@@ -1,12 +1,25 @@
 #include "search_server.h"
 
+#include "allocation_counter.h"
+#include "async_search_server.h"
+#include "concurrent_hash_map.h"
+#include "concurrent_map.h"
+#include "document_loader.h"
+#include "index_file.h"
 #include "log_duration.h"
 #include "process_queries.h"
+#include "query_cache.h"
+#include "query_replay.h"
+#include "request_queue.h"
+#include "sharded_search_server.h"
 
+#include <chrono>
 #include <execution>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -45,11 +58,30 @@ string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int w
     return query;
 }
 
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count, double minus_prob = 0) {
     vector<string> queries;
     queries.reserve(query_count);
     for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count, minus_prob));
+    }
+    return queries;
+}
+
+// Words are picked with Zipf frequencies like in natural text, so posting lists differ a lot in length
+vector<string> GenerateSkewedQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int word_count) {
+    vector<double> weights(dictionary.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> pick_word(weights.begin(), weights.end());
+    vector<string> queries(query_count);
+    for (string& query : queries) {
+        for (int i = 0; i < word_count; ++i) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            query += dictionary[pick_word(generator)];
+        }
     }
     return queries;
 }
@@ -66,21 +98,355 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 
+void TestSharded(const ShardedSearchServer& search_server, const vector<string>& queries) {
+    LOG_DURATION("sharded"s);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
-int main() {
-    mt19937 generator;
+template <typename AddFunction>
+void TestIngestion(string_view mark, const string& stop_words, const vector<string>& documents, AddFunction add) {
+    SearchServer search_server(stop_words);
+    const auto start = chrono::steady_clock::now();
+    add(search_server);
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << mark << ": "s << search_server.GetDocumentCount() << " documents, "s
+         << static_cast<int>(documents.size() / elapsed.count()) << " docs/sec"s << endl;
+}
 
-    const auto dictionary = GenerateDictionary(generator, 1000, 10);
-    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+void BenchmarkIngestion(const string& stop_words, const vector<string>& documents) {
+    vector<RawDocument> batch;
+    batch.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3} });
+    }
+
+    TestIngestion("AddDocument"s, stop_words, documents, [&documents](SearchServer& search_server) {
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    });
+    TestIngestion("AddDocuments(par)"s, stop_words, documents, [&batch](SearchServer& search_server) {
+        search_server.AddDocuments(execution::par, batch);
+    });
+}
 
-    SearchServer search_server(dictionary[0]);
+void BenchmarkDocumentLoader(const string& stop_words, const vector<string>& documents, const string& path) {
+    {
+        ofstream out(path);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            out << i << "\tACTUAL\t1 2 3\t"s << documents[i] << '\n';
+        }
+    }
+    SearchServer search_server(stop_words);
+    LOG_DURATION("LoadDocuments"s);
+    const DocumentLoadStats stats = LoadDocuments(search_server, path);
+    cout << "loaded "s << stats.document_count << " documents, "s << stats.byte_count / 1024 << " KiB in "s
+         << stats.batch_count << " batches"s << endl;
+}
+
+template <typename RemoveFunction>
+void TestRemoval(string_view mark, const string& stop_words, const vector<string>& documents,
+    const SearchServerOptions& options, RemoveFunction remove) {
+    SearchServer search_server(stop_words, options);
     for (size_t i = 0; i < documents.size(); ++i) {
         search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
     }
+    LOG_DURATION(mark);
+    remove(search_server);
+}
+
+void BenchmarkRemoval(const string& stop_words, const vector<string>& documents) {
+    // Expire every other document, as a bulk purge would
+    vector<int> document_ids;
+    for (size_t i = 0; i < documents.size(); i += 2) {
+        document_ids.push_back(static_cast<int>(i));
+    }
+
+    TestRemoval("RemoveDocument"s, stop_words, documents, {}, [&document_ids](SearchServer& search_server) {
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+        }
+    });
+    TestRemoval("RemoveDocuments(par)"s, stop_words, documents, {}, [&document_ids](SearchServer& search_server) {
+        search_server.RemoveDocuments(execution::par, document_ids);
+    });
+    SearchServerOptions lazy_options;
+    lazy_options.lazy_removal = true;
+    TestRemoval("RemoveDocument, lazy removal"s, stop_words, documents, lazy_options, [&document_ids](SearchServer& search_server) {
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+        }
+    });
+}
+
+void ReportMemory(const string& stop_words, const vector<string>& documents) {
+    for (const bool compress_postings : {false, true}) {
+        SearchServerOptions options;
+        options.compress_postings = compress_postings;
+        SearchServer search_server(stop_words, options);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const IndexMemoryStats stats = search_server.GetMemoryStats();
+        cout << (compress_postings ? "compressed postings: "s : "plain postings: "s)
+             << stats.posting_count << " postings, "s
+             << static_cast<double>(stats.posting_bytes) / stats.posting_count << " bytes/posting, forward index "s
+             << static_cast<double>(stats.forward_index_bytes) / stats.posting_count << " bytes/posting, documents "s
+             << static_cast<double>(stats.document_bytes) / search_server.GetDocumentCount() << " bytes/document"s << endl;
+        if (!compress_postings) {
+            cout << "interned words: "s << stats.interned_word_count << " words, "s
+                 << stats.interned_word_bytes << " bytes of text, "s
+                 << stats.word_storage_bytes << " bytes of storage"s << endl;
+        }
+    }
+}
+
+void ReportForwardIndexMemory(const string& stop_words, const vector<string>& documents) {
+    vector<RawDocument> raw_documents;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        raw_documents.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3} });
+    }
+    for (const auto& [mark, forward_index] : { pair{ "map"s, ForwardIndexMode::MAP },
+        pair{ "compact"s, ForwardIndexMode::COMPACT }, pair{ "none"s, ForwardIndexMode::NONE } }) {
+        SearchServerOptions options;
+        options.forward_index = forward_index;
+        SearchServer search_server(stop_words, options);
+        search_server.AddDocuments(execution::par, raw_documents);
+        const IndexMemoryStats stats = search_server.GetMemoryStats();
+        cout << "forward index "s << mark << ": "s << documents.size() << " documents, "s
+             << stats.forward_index_bytes / (1 << 20) << " MiB, postings "s
+             << stats.posting_bytes / (1 << 20) << " MiB"s << endl;
+    }
+}
+
+void BenchmarkMaxScore(const vector<string>& dictionary) {
+    mt19937 generator;
+    const auto documents = GenerateSkewedQueries(generator, dictionary, 50'000, 30);
+    const auto queries = GenerateSkewedQueries(generator, dictionary, 1'000, 3);
+    vector<RawDocument> raw_documents;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        raw_documents.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3} });
+    }
+    for (const bool max_score_pruning : { false, true }) {
+        SearchServerOptions options;
+        options.max_score_pruning = max_score_pruning;
+        SearchServer search_server(""s, options);
+        search_server.AddDocuments(execution::par, raw_documents);
+        Test(max_score_pruning ? "seq, skewed 3-word queries, MaxScore"s : "seq, skewed 3-word queries, exhaustive"s,
+            search_server, queries, execution::seq);
+    }
+}
+
+void BenchmarkIndexFile(const SearchServer& search_server, const string& path) {
+    {
+        LOG_DURATION("SaveIndex"s);
+        SaveIndex(search_server, path);
+    }
+    for (const auto& [mark, mode] : { pair{ "LoadIndex, copy"s, IndexLoadMode::COPY }, pair{ "LoadIndex, view"s, IndexLoadMode::VIEW } }) {
+        LOG_DURATION(mark);
+        const SearchServer loaded_server = LoadIndex(path, {}, mode);
+        cout << "loaded "s << loaded_server.GetDocumentCount() << " documents"s << endl;
+    }
+}
+
+void BenchmarkQueryExecutor(const SearchServer& search_server, const vector<string>& queries) {
+    QueryExecutor executor;
+    {
+        LOG_DURATION("ProcessQueriesJoined"s);
+        cout << executor.ProcessQueriesJoined(search_server, queries).size() << " documents"s << endl;
+    }
+    const QueryLatencyStats stats = executor.GetLatencyStats();
+    cout << stats.query_count << " queries, p50 "s << stats.p50.count() << " us, p90 "s
+         << stats.p90.count() << " us, p99 "s << stats.p99.count() << " us"s << endl;
+}
+
+void BenchmarkAsync(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    AsyncSearchServer async_server(search_server);
+    LOG_DURATION(mark);
+    vector<future<vector<Document>>> results;
+    for (const string& query : queries) {
+        results.push_back(async_server.FindTopDocuments(query));
+    }
+    double total_relevance = 0;
+    for (auto& result : results) {
+        for (const Document& document : result.get()) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
+void BenchmarkQueryCache(const SearchServer& search_server, const vector<string>& queries) {
+    QueryCache query_cache(search_server);
+    RequestQueue request_queue(query_cache);
+    {
+        LOG_DURATION("RequestQueue with QueryCache"s);
+        for (const string& query : queries) {
+            request_queue.AddFindRequest(query);
+        }
+    }
+    const QueryCacheStats stats = query_cache.GetStats();
+    cout << stats.hits << " hits, "s << stats.misses << " misses, "s << stats.evictions << " evictions"s << endl;
+}
+
+// Every thread adds 1 to the values of its keys; the total must equal the number of updates
+template <typename Map>
+void TestConcurrentMap(string_view mark, Map& map, const vector<vector<int>>& thread_keys) {
+    {
+        LOG_DURATION(mark);
+        vector<thread> threads;
+        for (const vector<int>& keys : thread_keys) {
+            threads.emplace_back([&map, &keys] {
+                for (const int key : keys) {
+                    map[key].ref_to_value += 1;
+                }
+            });
+        }
+        for (thread& thread : threads) {
+            thread.join();
+        }
+    }
+    int64_t total = 0;
+    for (const auto& [key, value] : map.BuildOrdinaryMap()) {
+        total += value;
+    }
+    cout << total << endl;
+}
+
+void BenchmarkConcurrentMaps() {
+    const int key_count = 10'000;
+    const int update_count = 1'000'000;
+    for (const bool is_skewed : {false, true}) {
+        for (const int thread_count : {1, 4, 16, 64}) {
+            // Skewed updates pick one of 16 hot keys nine times out of ten
+            mt19937 generator;
+            vector<vector<int>> thread_keys(thread_count);
+            for (vector<int>& keys : thread_keys) {
+                for (int i = 0; i < update_count / thread_count; ++i) {
+                    const bool is_hot = is_skewed && generator() % 10 != 0;
+                    keys.push_back(static_cast<int>(generator() % (is_hot ? 16 : key_count)));
+                }
+            }
+            const string mark = (is_skewed ? "skewed keys, "s : "uniform keys, "s) + to_string(thread_count) + " threads"s;
+            for (const size_t bucket_count : {16, 1024}) {
+                ConcurrentMap<int, int64_t> map(bucket_count);
+                TestConcurrentMap("ConcurrentMap, "s + to_string(bucket_count) + " buckets, "s + mark, map, thread_keys);
+            }
+            ConcurrentHashMap<int, int64_t> map(key_count);
+            TestConcurrentMap("ConcurrentHashMap, "s + mark, map, thread_keys);
+        }
+    }
+}
+
+void BenchmarkQueryReplay(const SearchServer& search_server, const vector<string>& queries, const string& path) {
+    {
+        ofstream out(path);
+        for (const string& query : queries) {
+            out << query << '\n';
+        }
+    }
+    for (const size_t thread_count : {1, 4, 16}) {
+        QueryReplayOptions options;
+        options.thread_count = thread_count;
+        options.allocation_counter = GetThreadAllocationCount;
+        PrintReportJson(cout, ReplayQueries(search_server, path, options));
+    }
+}
+
+// main replay <index file> <query file> [thread count] [batch size]
+int ReplayQueryLog(int argc, char* argv[]) {
+    const auto print_usage = [argv] {
+        cerr << "Usage: "s << argv[0] << " replay <index file> <query file> [thread count] [batch size]"s << endl;
+        return 1;
+    };
+    if (argc < 4) {
+        return print_usage();
+    }
+    QueryReplayOptions options;
+    options.allocation_counter = GetThreadAllocationCount;
+    try {
+        if (argc > 4) {
+            options.thread_count = stoul(argv[4]);
+        }
+        if (argc > 5) {
+            options.batch_size = stoul(argv[5]);
+        }
+    }
+    catch (const logic_error&) {
+        // invalid_argument or out_of_range from stoul
+        return print_usage();
+    }
+    if (options.batch_size == 0) {
+        return print_usage();
+    }
+    const SearchServer search_server = LoadIndex(argv[2]);
+    PrintReportJson(cout, ReplayQueries(search_server, argv[3], options));
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1] == "replay"s) {
+        return ReplayQueryLog(argc, argv);
+    }
+
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
 
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+    const auto minus_queries = GenerateQueries(generator, dictionary, 100, 70, 0.3);
+    const auto query_log = GenerateQueries(generator, dictionary, 10'000, 70);
+
+    BenchmarkConcurrentMaps();
+    BenchmarkIngestion(dictionary[0], documents);
+    BenchmarkDocumentLoader(dictionary[0], documents, "benchmark_documents.tsv"s);
+    BenchmarkRemoval(dictionary[0], documents);
+    ReportMemory(dictionary[0], documents);
+    ReportForwardIndexMemory(dictionary[0], GenerateQueries(generator, dictionary, 1'000'000, 10));
 
-    TEST(seq);
-    TEST(par);
+    for (const size_t shard_count : {1, 4, 16}) {
+        SearchServer search_server(dictionary[0], SearchServerOptions{ shard_count });
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+
+        cout << "parallel shards: "s << shard_count << endl;
+        TEST(seq);
+        TEST(par);
+        Test("seq, 30% minus words"s, search_server, minus_queries, execution::seq);
+        Test("par, 30% minus words"s, search_server, minus_queries, execution::par);
+        if (shard_count == 1) {
+            BenchmarkMaxScore(dictionary);
+            BenchmarkIndexFile(search_server, "benchmark_index.bin"s);
+            BenchmarkQueryExecutor(search_server, queries);
+            BenchmarkQueryReplay(search_server, query_log, "benchmark_queries.txt"s);
+            BenchmarkAsync("AsyncSearchServer"s, search_server, queries);
+            // Skewed traffic where ten queries make up the whole load
+            vector<string> repeated_queries;
+            for (size_t i = 0; i < queries.size(); ++i) {
+                repeated_queries.push_back(queries[i % 10]);
+            }
+            Test("seq, repeated queries"s, search_server, repeated_queries, execution::seq);
+            BenchmarkAsync("AsyncSearchServer, repeated queries"s, search_server, repeated_queries);
+            BenchmarkQueryCache(search_server, repeated_queries);
+        }
+    }
+
+    for (const size_t shard_count : {4, 16}) {
+        ShardedSearchServer search_server(dictionary[0], shard_count);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        cout << "index shards: "s << shard_count << endl;
+        TestSharded(search_server, queries);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Array of trivially copyable values that either owns them or views values owned by someone
+// else, such as an index file mapped into memory. A view is never written through: the first
+// change copies it into owned storage. Copies of a view view the same values.
+template <typename Value>
+class MappableArray {
+    static_assert(std::is_trivially_copyable_v<Value>);
+
+public:
+                                MappableArray() = default;
+
+                                MappableArray(std::initializer_list<Value> values);
+
+                                MappableArray(const MappableArray& other);
+
+                                MappableArray(MappableArray&& other) noexcept;
+
+    MappableArray&              operator=(const MappableArray& other);
+
+    MappableArray&              operator=(MappableArray&& other) noexcept;
+
+    // The values must outlive the array and all of its copies
+    void                        AssignView(const Value* values, size_t size);
+
+    void                        Assign(std::vector<Value> values);
+
+    // Leaves the array empty and owning
+    std::vector<Value>          Release();
+
+    bool                        IsView() const;
+
+    // Copies viewed values into owned storage
+    void                        Detach();
+
+    const Value*                data() const;
+
+    size_t                      size() const;
+
+    bool                        empty() const;
+
+    const Value&                operator[](size_t index) const;
+
+    const Value&                back() const;
+
+    const Value*                begin() const;
+
+    const Value*                end() const;
+
+    // Detaches a view; the pointer is valid until the next change of the array
+    Value*                      MutableData();
+
+    void                        push_back(const Value& value);
+
+    void                        reserve(size_t capacity);
+
+    void                        resize(size_t size, const Value& value = {});
+
+    void                        clear();
+
+    // Heap bytes owned by the array, 0 for a view
+    size_t                      GetMemoryUsage() const;
+
+private:
+    std::vector<Value>          owned_;
+    // Either owned_.data() or the viewed values
+    const Value*                data_ = nullptr;
+    size_t                      size_ = 0;
+    bool                        is_view_ = false;
+
+    void                        Sync();
+};
+
+template <typename Value>
+MappableArray<Value>::MappableArray(std::initializer_list<Value> values)
+    : owned_(values) {
+    Sync();
+}
+
+template <typename Value>
+MappableArray<Value>::MappableArray(const MappableArray& other)
+    : owned_(other.owned_)
+    , data_(other.data_)
+    , size_(other.size_)
+    , is_view_(other.is_view_) {
+    if (!is_view_) {
+        Sync();
+    }
+}
+
+template <typename Value>
+MappableArray<Value>::MappableArray(MappableArray&& other) noexcept
+    : owned_(std::move(other.owned_))
+    , data_(other.data_)
+    , size_(other.size_)
+    , is_view_(other.is_view_) {
+    other.clear();
+}
+
+template <typename Value>
+MappableArray<Value>& MappableArray<Value>::operator=(const MappableArray& other) {
+    if (this != &other) {
+        MappableArray copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename Value>
+MappableArray<Value>& MappableArray<Value>::operator=(MappableArray&& other) noexcept {
+    if (this != &other) {
+        // Moving a vector keeps its buffer, so data_ stays valid for owned values too
+        owned_ = std::move(other.owned_);
+        data_ = other.data_;
+        size_ = other.size_;
+        is_view_ = other.is_view_;
+        other.clear();
+    }
+    return *this;
+}
+
+template <typename Value>
+void MappableArray<Value>::AssignView(const Value* values, size_t size) {
+    owned_ = {};
+    data_ = values;
+    size_ = size;
+    is_view_ = true;
+}
+
+template <typename Value>
+void MappableArray<Value>::Assign(std::vector<Value> values) {
+    owned_ = std::move(values);
+    is_view_ = false;
+    Sync();
+}
+
+template <typename Value>
+std::vector<Value> MappableArray<Value>::Release() {
+    Detach();
+    std::vector<Value> values = std::move(owned_);
+    clear();
+    return values;
+}
+
+template <typename Value>
+bool MappableArray<Value>::IsView() const {
+    return is_view_;
+}
+
+template <typename Value>
+void MappableArray<Value>::Detach() {
+    if (is_view_) {
+        owned_.assign(data_, data_ + size_);
+        is_view_ = false;
+        Sync();
+    }
+}
+
+template <typename Value>
+const Value* MappableArray<Value>::data() const {
+    return data_;
+}
+
+template <typename Value>
+size_t MappableArray<Value>::size() const {
+    return size_;
+}
+
+template <typename Value>
+bool MappableArray<Value>::empty() const {
+    return size_ == 0;
+}
+
+template <typename Value>
+const Value& MappableArray<Value>::operator[](size_t index) const {
+    return data_[index];
+}
+
+template <typename Value>
+const Value& MappableArray<Value>::back() const {
+    return data_[size_ - 1];
+}
+
+template <typename Value>
+const Value* MappableArray<Value>::begin() const {
+    return data_;
+}
+
+template <typename Value>
+const Value* MappableArray<Value>::end() const {
+    return data_ + size_;
+}
+
+template <typename Value>
+Value* MappableArray<Value>::MutableData() {
+    Detach();
+    return owned_.data();
+}
+
+template <typename Value>
+void MappableArray<Value>::push_back(const Value& value) {
+    Detach();
+    owned_.push_back(value);
+    Sync();
+}
+
+template <typename Value>
+void MappableArray<Value>::reserve(size_t capacity) {
+    Detach();
+    owned_.reserve(capacity);
+    Sync();
+}
+
+template <typename Value>
+void MappableArray<Value>::resize(size_t size, const Value& value) {
+    Detach();
+    owned_.resize(size, value);
+    Sync();
+}
+
+template <typename Value>
+void MappableArray<Value>::clear() {
+    owned_.clear();
+    is_view_ = false;
+    Sync();
+}
+
+template <typename Value>
+size_t MappableArray<Value>::GetMemoryUsage() const {
+    return owned_.capacity() * sizeof(Value);
+}
+
+template <typename Value>
+void MappableArray<Value>::Sync() {
+    data_ = owned_.data();
+    size_ = owned_.size();
+}
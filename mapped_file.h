@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file. On POSIX systems the file is mapped into memory, so its
+// pages are loaded on first access and can be dropped again; elsewhere it is read into a buffer.
+class MappedFile {
+public:
+    // Pages of a sequential file are read ahead and dropped early; others are paged in
+    // on demand like ordinary memory
+    explicit                    MappedFile(const std::string& path, bool is_sequential = true);
+
+                                MappedFile(const MappedFile&) = delete;
+    MappedFile&                 operator=(const MappedFile&) = delete;
+
+                                ~MappedFile();
+
+    const char*                 data() const;
+
+    size_t                      size() const;
+
+    // Tells the system that the bytes before offset will not be read again, so their pages
+    // stop counting towards the resident memory of the process
+    void                        Release(size_t offset);
+
+private:
+    const char*                 data_ = nullptr;
+    size_t                      size_ = 0;
+    size_t                      released_ = 0;
+#ifdef _WIN32
+    std::string                 buffer_;
+#endif
+};
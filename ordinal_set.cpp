@@ -0,0 +1,24 @@
+#include "ordinal_set.h"
+
+using namespace std;
+
+void OrdinalSet::Reset(size_t document_count) {
+    for (const size_t word : used_words_) {
+        bits_[word] = 0;
+    }
+    used_words_.clear();
+    const size_t word_count = (document_count + 63) / 64;
+    if (bits_.size() < word_count) {
+        bits_.resize(word_count, 0);
+    }
+}
+
+bool OrdinalSet::empty() const {
+    return used_words_.empty();
+}
+
+OrdinalSet& GetThreadOrdinalSet(size_t document_count) {
+    thread_local OrdinalSet ordinal_set;
+    ordinal_set.Reset(document_count);
+    return ordinal_set;
+}
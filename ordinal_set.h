@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set of document ordinals stored as a bitmap. Reset only clears the words that were set,
+// so a reused set costs nothing for ordinals the previous query did not touch.
+class OrdinalSet {
+public:
+    void                        Reset(size_t document_count);
+
+    void                        Insert(int ordinal);
+
+    bool                        Contains(int ordinal) const;
+
+    bool                        empty() const;
+
+private:
+    std::vector<uint64_t>       bits_;
+    std::vector<size_t>         used_words_;
+};
+
+// One set per thread, reused across queries like the relevance accumulator
+OrdinalSet& GetThreadOrdinalSet(size_t document_count);
+
+inline void OrdinalSet::Insert(int ordinal) {
+    uint64_t& word = bits_[ordinal / 64];
+    if (word == 0) {
+        used_words_.push_back(ordinal / 64);
+    }
+    word |= uint64_t{ 1 } << (ordinal % 64);
+}
+
+inline bool OrdinalSet::Contains(int ordinal) const {
+    return (bits_[ordinal / 64] >> (ordinal % 64)) & 1;
+}
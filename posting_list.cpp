@@ -0,0 +1,273 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings) {
+    if (postings_->compressed_ && !postings_->blocks_.empty()) {
+        LoadBlock(0);
+    }
+    else {
+        Load();
+    }
+}
+
+void PostingList::Cursor::Next() {
+    ++index_;
+    if (!postings_->compressed_) {
+        Load();
+    }
+    else if (index_ == postings_->size_) {
+        ordinal_ = INT_MAX;
+    }
+    else if (index_ % BLOCK_SIZE == 0) {
+        LoadBlock(index_ / BLOCK_SIZE);
+    }
+    else {
+        ordinal_ += ReadDelta(data_);
+        term_freq_ = ReadTermFreq(data_);
+    }
+}
+
+void PostingList::Cursor::NextGeq(int target) {
+    if (target <= ordinal_) {
+        return;
+    }
+    if (!postings_->compressed_) {
+        const auto& postings = postings_->postings_;
+        index_ = lower_bound(postings.begin() + index_, postings.end(), target,
+            [](const Posting& posting, int value) { return posting.ordinal < value; }) - postings.begin();
+        Load();
+        return;
+    }
+    // Whole blocks before the target are skipped without decoding them
+    const size_t block = postings_->FindBlock(target);
+    if (block > block_) {
+        LoadBlock(block);
+    }
+    while (ordinal_ < target) {
+        Next();
+    }
+}
+
+void PostingList::Cursor::Load() {
+    const auto& postings = postings_->postings_;
+    if (index_ < postings.size()) {
+        ordinal_ = postings[index_].ordinal;
+        term_freq_ = postings[index_].term_freq;
+    }
+    else {
+        ordinal_ = INT_MAX;
+    }
+}
+
+void PostingList::Cursor::LoadBlock(size_t block) {
+    block_ = block;
+    index_ = block * BLOCK_SIZE;
+    data_ = postings_->bytes_.data() + postings_->blocks_[block].offset;
+    ordinal_ = postings_->blocks_[block].first_ordinal;
+    term_freq_ = ReadTermFreq(data_);
+}
+
+PostingList::PostingList(bool compressed)
+    : compressed_(compressed) {}
+
+bool PostingList::AssignView(const Posting* postings, size_t size, int ordinal_count) {
+    int last_ordinal = -1;
+    double max_term_freq = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        const Posting& posting = postings[i];
+        if (posting.ordinal <= last_ordinal || posting.ordinal >= ordinal_count
+            || !isfinite(posting.term_freq) || posting.term_freq <= 0.0) {
+            return false;
+        }
+        last_ordinal = posting.ordinal;
+        max_term_freq = max(max_term_freq, posting.term_freq);
+    }
+    compressed_ = false;
+    postings_.AssignView(postings, size);
+    bytes_.clear();
+    blocks_.clear();
+    size_ = size;
+    last_ordinal_ = last_ordinal;
+    max_term_freq_ = max_term_freq;
+    return true;
+}
+
+bool PostingList::AssignView(size_t size, const uint8_t* bytes, size_t byte_count,
+    const Block* blocks, size_t block_count, int ordinal_count) {
+    if (block_count != (size + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+        return false;
+    }
+    // Decodes every block with bounds checks, so cursors can later decode without them
+    const uint8_t* data = bytes;
+    const uint8_t* const data_end = bytes + byte_count;
+    int64_t last_ordinal = -1;
+    double max_term_freq = 0.0;
+    for (size_t block = 0; block < block_count; ++block) {
+        if (blocks[block].offset != static_cast<size_t>(data - bytes)) {
+            return false;
+        }
+        int64_t ordinal = blocks[block].first_ordinal;
+        const size_t count = block + 1 < block_count ? BLOCK_SIZE : size - block * BLOCK_SIZE;
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                // A delta below 2^32 takes at most 5 bytes
+                uint32_t delta = 0;
+                for (int shift = 0;; shift += 7) {
+                    if (data == data_end || shift > 28) {
+                        return false;
+                    }
+                    const uint8_t byte = *data++;
+                    delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                    if ((byte & 0x80) == 0) {
+                        break;
+                    }
+                }
+                ordinal += delta;
+            }
+            if (ordinal <= last_ordinal || ordinal >= ordinal_count || data_end - data < 2) {
+                return false;
+            }
+            max_term_freq = max(max_term_freq, ReadTermFreq(data));
+            last_ordinal = ordinal;
+        }
+    }
+    if (data != data_end) {
+        return false;
+    }
+    compressed_ = true;
+    postings_.clear();
+    bytes_.AssignView(bytes, byte_count);
+    blocks_.AssignView(blocks, block_count);
+    size_ = size;
+    last_ordinal_ = static_cast<int>(last_ordinal);
+    max_term_freq_ = max_term_freq;
+    return true;
+}
+
+void PostingList::Detach() {
+    postings_.Detach();
+    bytes_.Detach();
+    blocks_.Detach();
+}
+
+void PostingList::Append(int ordinal, double term_freq) {
+    if (compressed_) {
+        AppendCompressed(ordinal, term_freq);
+    }
+    else {
+        postings_.push_back({ ordinal, term_freq });
+        max_term_freq_ = max(max_term_freq_, term_freq);
+    }
+    ++size_;
+    last_ordinal_ = ordinal;
+}
+
+bool PostingList::Erase(int ordinal) {
+    if (!Contains(ordinal)) {
+        return false;
+    }
+    EraseIf([ordinal](int other) { return other == ordinal; });
+    return true;
+}
+
+bool PostingList::Contains(int ordinal) const {
+    bool found = false;
+    ForEach(ordinal, ordinal + 1, [&found](int, double) { found = true; });
+    return found;
+}
+
+bool PostingList::IsCompressed() const {
+    return compressed_;
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+int PostingList::GetLastOrdinal() const {
+    return last_ordinal_;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+PostingList::Cursor PostingList::GetCursor() const {
+    return Cursor(*this);
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return sizeof(PostingList)
+        + postings_.GetMemoryUsage()
+        + bytes_.GetMemoryUsage()
+        + blocks_.GetMemoryUsage();
+}
+
+const Posting* PostingList::LowerBound(int ordinal) const {
+    return lower_bound(postings_.begin(), postings_.end(), ordinal,
+        [](const Posting& posting, int value) { return posting.ordinal < value; });
+}
+
+size_t PostingList::FindBlock(int ordinal) const {
+    // The last block starting at or before ordinal is the only one that may contain it
+    const auto it = upper_bound(blocks_.begin(), blocks_.end(), ordinal,
+        [](int value, const Block& block) { return value < block.first_ordinal; });
+    return it == blocks_.begin() ? 0 : static_cast<size_t>(it - blocks_.begin()) - 1;
+}
+
+vector<Posting> PostingList::Decode() const {
+    vector<Posting> postings;
+    postings.reserve(size_);
+    ForEach([&postings](int ordinal, double term_freq) { postings.push_back({ ordinal, term_freq }); });
+    return postings;
+}
+
+void PostingList::AppendCompressed(int ordinal, double term_freq) {
+    if (size_ % BLOCK_SIZE == 0) {
+        blocks_.push_back({ ordinal, static_cast<uint32_t>(bytes_.size()) });
+    }
+    else {
+        uint32_t delta = static_cast<uint32_t>(ordinal - last_ordinal_);
+        while (delta >= 0x80) {
+            bytes_.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        bytes_.push_back(static_cast<uint8_t>(delta));
+    }
+    const double clamped_freq = min(max(term_freq, 0.0), 1.0);
+    const uint16_t quantized_freq = static_cast<uint16_t>(lround(clamped_freq * TERM_FREQ_SCALE));
+    bytes_.push_back(static_cast<uint8_t>(quantized_freq & 0xFF));
+    bytes_.push_back(static_cast<uint8_t>(quantized_freq >> 8));
+    // The bound must hold for the decoded frequencies, which may be rounded up
+    max_term_freq_ = max(max_term_freq_, quantized_freq / TERM_FREQ_SCALE);
+}
+
+void PostingList::Assign(vector<Posting> postings) {
+    postings_.clear();
+    bytes_.clear();
+    blocks_.clear();
+    size_ = 0;
+    last_ordinal_ = -1;
+    max_term_freq_ = 0.0;
+    if (compressed_) {
+        for (const Posting& posting : postings) {
+            Append(posting.ordinal, posting.term_freq);
+        }
+        return;
+    }
+    postings_.Assign(move(postings));
+    for (const Posting& posting : postings_) {
+        max_term_freq_ = max(max_term_freq_, posting.term_freq);
+    }
+    size_ = postings_.size();
+    last_ordinal_ = postings_.empty() ? -1 : postings_.back().ordinal;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "mappable_array.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class SearchServer;
+
+struct Posting {
+    int ordinal;
+    double term_freq;
+};
+
+// Postings of one term sorted by document ordinal. A compressed list stores blocks of
+// delta-encoded varint ordinals with term frequencies quantized to 16 bits, and is decoded
+// on the fly while iterating. The arrays of a list can be views of a mapped index file.
+class PostingList {
+public:
+    // Block of a compressed list: the first posting is stored without a delta from first_ordinal
+    struct Block {
+        int                     first_ordinal;
+        uint32_t                offset;
+    };
+
+    // Walks the postings in ordinal order and can skip ahead without visiting the skipped ones
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        // INT_MAX once the cursor is past the last posting
+        int                     GetOrdinal() const;
+
+        double                  GetTermFreq() const;
+
+        void                    Next();
+
+        // Moves to the first posting with ordinal >= target, never backwards
+        void                    NextGeq(int target);
+
+    private:
+        const PostingList*      postings_;
+        size_t                  index_ = 0;
+        size_t                  block_ = 0;
+        const uint8_t*          data_ = nullptr;
+        int                     ordinal_ = INT_MAX;
+        double                  term_freq_ = 0.0;
+
+        void                    Load();
+
+        void                    LoadBlock(size_t block);
+    };
+
+    explicit PostingList(bool compressed = false);
+
+    // Views arrays owned by someone else instead of copying them: the postings of a flat list,
+    // or the bytes and blocks of a compressed one. Returns false, leaving the list unchanged,
+    // if they do not hold size postings with ascending ordinals below ordinal_count.
+    bool                        AssignView(const Posting* postings, size_t size, int ordinal_count);
+
+    bool                        AssignView(size_t size, const uint8_t* bytes, size_t byte_count,
+                                    const Block* blocks, size_t block_count, int ordinal_count);
+
+    // Copies viewed arrays into storage owned by the list
+    void                        Detach();
+
+    void                        Append(int ordinal, double term_freq);
+
+    bool                        Erase(int ordinal);
+
+    // Removes the postings whose ordinal satisfies predicate in one pass over the list,
+    // returns the number of removed postings
+    template <typename Predicate>
+    size_t                      EraseIf(Predicate predicate);
+
+    bool                        Contains(int ordinal) const;
+
+    // Calls callback(ordinal, term_freq) for postings with first_ordinal <= ordinal < last_ordinal
+    template <typename Callback>
+    void                        ForEach(int first_ordinal, int last_ordinal, Callback callback) const;
+
+    template <typename Callback>
+    void                        ForEach(Callback callback) const;
+
+    bool                        IsCompressed() const;
+
+    size_t                      size() const;
+
+    bool                        empty() const;
+
+    int                         GetLastOrdinal() const;
+
+    // Upper bound of the term frequencies in the list, not lowered when postings are erased
+    double                      GetMaxTermFreq() const;
+
+    Cursor                      GetCursor() const;
+
+    size_t                      GetMemoryUsage() const;
+
+private:
+    friend void SaveIndex(const SearchServer& search_server, const std::string& path);
+
+    static const size_t         BLOCK_SIZE = 128;
+    static constexpr double     TERM_FREQ_SCALE = 65535.0;
+
+    bool                        compressed_;
+    MappableArray<Posting>      postings_;
+    MappableArray<uint8_t>      bytes_;
+    MappableArray<Block>        blocks_;
+    size_t                      size_ = 0;
+    int                         last_ordinal_ = -1;
+    double                      max_term_freq_ = 0.0;
+
+    const Posting*              LowerBound(int ordinal) const;
+
+    size_t                      FindBlock(int ordinal) const;
+
+    std::vector<Posting>        Decode() const;
+
+    void                        AppendCompressed(int ordinal, double term_freq);
+
+    void                        Assign(std::vector<Posting> postings);
+
+    static int                  ReadDelta(const uint8_t*& data);
+
+    static double               ReadTermFreq(const uint8_t*& data);
+};
+
+inline int PostingList::Cursor::GetOrdinal() const {
+    return ordinal_;
+}
+
+inline double PostingList::Cursor::GetTermFreq() const {
+    return term_freq_;
+}
+
+inline int PostingList::ReadDelta(const uint8_t*& data) {
+    uint32_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = *data++;
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return static_cast<int>(delta);
+}
+
+inline double PostingList::ReadTermFreq(const uint8_t*& data) {
+    const uint16_t quantized_freq = static_cast<uint16_t>(data[0] | (data[1] << 8));
+    data += 2;
+    return quantized_freq / TERM_FREQ_SCALE;
+}
+
+template <typename Callback>
+void PostingList::ForEach(int first_ordinal, int last_ordinal, Callback callback) const {
+    if (!compressed_) {
+        for (auto it = LowerBound(first_ordinal); it != postings_.end() && it->ordinal < last_ordinal; ++it) {
+            callback(it->ordinal, it->term_freq);
+        }
+        return;
+    }
+    for (size_t block = FindBlock(first_ordinal); block < blocks_.size(); ++block) {
+        const uint8_t* data = bytes_.data() + blocks_[block].offset;
+        const size_t count = block + 1 < blocks_.size() ? BLOCK_SIZE : size_ - block * BLOCK_SIZE;
+        int ordinal = blocks_[block].first_ordinal;
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                ordinal += ReadDelta(data);
+            }
+            const double term_freq = ReadTermFreq(data);
+            if (ordinal >= last_ordinal) {
+                return;
+            }
+            if (ordinal >= first_ordinal) {
+                callback(ordinal, term_freq);
+            }
+        }
+    }
+}
+
+template <typename Predicate>
+size_t PostingList::EraseIf(Predicate predicate) {
+    std::vector<Posting> postings = compressed_ ? Decode() : postings_.Release();
+    const auto kept_end = std::remove_if(postings.begin(), postings.end(),
+        [&predicate](const Posting& posting) { return predicate(posting.ordinal); });
+    const size_t erased_count = static_cast<size_t>(postings.end() - kept_end);
+    postings.erase(kept_end, postings.end());
+    Assign(std::move(postings));
+    return erased_count;
+}
+
+template <typename Callback>
+void PostingList::ForEach(Callback callback) const {
+    ForEach(0, INT_MAX, callback);
+}
@@ -1,30 +1,145 @@
 #include "process_queries.h"
-#include <execution>
-#include <numeric>
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 
 using namespace std;
 
-vector<vector<Document>> ProcessQueries(
+QueryExecutor::QueryExecutor(size_t thread_count, size_t queue_capacity)
+    : pool_(thread_count, queue_capacity) {}
+
+template <typename RunQuery>
+void QueryExecutor::RunBatch(size_t query_count, RunQuery run_query) {
+    mutex batch_mutex;
+    condition_variable batch_done;
+    size_t remaining = query_count;
+    exception_ptr first_exception;
+
+    for (size_t index = 0; index < query_count; ++index) {
+        pool_.Submit([&, index] {
+            const uint64_t start_allocation_count = allocation_counter_ == nullptr ? 0 : allocation_counter_();
+            const auto start = chrono::steady_clock::now();
+            exception_ptr exception;
+            try {
+                run_query(index);
+            }
+            catch (...) {
+                exception = current_exception();
+            }
+            latencies_.Add(chrono::steady_clock::now() - start);
+            if (allocation_counter_ != nullptr) {
+                allocation_count_.fetch_add(allocation_counter_() - start_allocation_count, memory_order_relaxed);
+            }
+
+            lock_guard guard(batch_mutex);
+            if (exception && !first_exception) {
+                first_exception = exception;
+            }
+            if (--remaining == 0) {
+                batch_done.notify_one();
+            }
+        });
+    }
+
+    unique_lock lock(batch_mutex);
+    batch_done.wait(lock, [&remaining] { return remaining == 0; });
+    if (first_exception) {
+        rethrow_exception(first_exception);
+    }
+}
+
+vector<vector<Document>> QueryExecutor::ProcessQueries(
     const SearchServer& search_server,
     const vector<string>& queries) {
     vector<vector<Document>> result(queries.size());
-    transform(execution::par, queries.begin(), queries.end(), result.begin(), [&search_server](const auto& query) {return search_server.FindTopDocuments(query); });
+    RunBatch(queries.size(), [&](size_t index) {
+        result[index] = search_server.FindTopDocuments(queries[index]);
+    });
+    return result;
+}
+
+vector<vector<Document>> QueryExecutor::ProcessQueries(
+    QueryCache& query_cache,
+    const vector<string>& queries) {
+    vector<vector<Document>> result(queries.size());
+    RunBatch(queries.size(), [&](size_t index) {
+        result[index] = query_cache.FindTopDocuments(queries[index]);
+    });
+    return result;
+}
+
+vector<Document> QueryExecutor::ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const vector<string>& queries) {
+    // Every query owns MAX_RESULT_DOCUMENT_COUNT slots of the output; the unused ones are
+    // squeezed out afterwards in a single pass
+    vector<Document> result(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+    vector<size_t> result_counts(queries.size());
+    RunBatch(queries.size(), [&](size_t index) {
+        const vector<Document> documents = search_server.FindTopDocuments(queries[index]);
+        copy(documents.begin(), documents.end(), result.begin() + index * MAX_RESULT_DOCUMENT_COUNT);
+        result_counts[index] = documents.size();
+    });
+
+    size_t size = 0;
+    for (size_t index = 0; index < queries.size(); ++index) {
+        const auto first = result.begin() + index * MAX_RESULT_DOCUMENT_COUNT;
+        move(first, first + result_counts[index], result.begin() + size);
+        size += result_counts[index];
+    }
+    result.resize(size);
     return result;
 }
 
+QueryLatencyStats QueryExecutor::GetLatencyStats() const {
+    return {
+        latencies_.GetCount(),
+        latencies_.GetPercentile(0.5),
+        latencies_.GetPercentile(0.9),
+        latencies_.GetPercentile(0.95),
+        latencies_.GetPercentile(0.99),
+        latencies_.GetPercentile(0.999),
+        allocation_count_.load(memory_order_relaxed)
+    };
+}
+
+void QueryExecutor::ResetLatencyStats() {
+    latencies_.Reset();
+    allocation_count_.store(0, memory_order_relaxed);
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+    return pool_.GetThreadCount();
+}
+
+void QueryExecutor::SetAllocationCounter(AllocationCounter allocation_counter) {
+    allocation_counter_ = allocation_counter;
+}
+
+bool QueryExecutor::HasAllocationCounter() const {
+    return allocation_counter_ != nullptr;
+}
+
+QueryExecutor& GetDefaultQueryExecutor() {
+    static QueryExecutor executor;
+    return executor;
+}
+
+vector<vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const vector<string>& queries) {
+    return GetDefaultQueryExecutor().ProcessQueries(search_server, queries);
+}
+
 vector <Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const vector<string>& queries) {
-    return transform_reduce(execution::par, 
-        queries.begin(), queries.end(), 
-        vector<Document>(),
-        [](vector<Document> lhs, vector<Document> rhs) {
-            lhs.insert(lhs.end(), rhs.begin(), rhs.end());
-            return lhs; 
-        },
-        [&search_server](const auto& query) {
-            return search_server.FindTopDocuments(query); 
-        });
+    return GetDefaultQueryExecutor().ProcessQueriesJoined(search_server, queries);
 }
 
+vector<vector<Document>> ProcessQueries(
+    QueryCache& query_cache,
+    const vector<string>& queries) {
+    return GetDefaultQueryExecutor().ProcessQueries(query_cache, queries);
+}
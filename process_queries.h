@@ -1,6 +1,74 @@
 #pragma once
 #include "search_server.h"
+#include "latency_histogram.h"
+#include "query_cache.h"
+#include "thread_pool.h"
 
+#include <atomic>
+#include <chrono>
+
+struct QueryLatencyStats {
+    uint64_t query_count = 0;
+    std::chrono::microseconds p50{};
+    std::chrono::microseconds p90{};
+    std::chrono::microseconds p95{};
+    std::chrono::microseconds p99{};
+    std::chrono::microseconds p999{};
+    // Allocations made while running the queries, including their results.
+    // Only counted when the executor has an allocation counter.
+    uint64_t allocation_count = 0;
+};
+
+// Number of allocations the calling thread has made so far
+using AllocationCounter = uint64_t (*)();
+
+// Runs queries on its own persistent thread pool, one task per query. Every query writes its
+// result into a slot reserved for it, and its latency is recorded for percentile reports.
+// If a query throws, the rest of the batch still runs and the first exception is rethrown.
+// With an allocation counter, allocations made by each query on its worker thread are counted as well.
+class QueryExecutor {
+public:
+    // thread_count 0 means hardware concurrency
+    explicit QueryExecutor(size_t thread_count = 0, size_t queue_capacity = 1024);
+
+    std::vector<std::vector<Document>> ProcessQueries(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
+    std::vector<Document> ProcessQueriesJoined(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
+    // Repeated queries are answered from query_cache
+    std::vector<std::vector<Document>> ProcessQueries(
+        QueryCache& query_cache,
+        const std::vector<std::string>& queries);
+
+    // Latencies and allocations of the queries processed since the last reset
+    QueryLatencyStats GetLatencyStats() const;
+
+    void ResetLatencyStats();
+
+    size_t GetThreadCount() const;
+
+    // Must not be called while queries run. nullptr, the default, stops counting.
+    void SetAllocationCounter(AllocationCounter allocation_counter);
+
+    bool HasAllocationCounter() const;
+
+private:
+    ThreadPool pool_;
+    LatencyHistogram latencies_;
+    std::atomic<uint64_t> allocation_count_ = 0;
+    AllocationCounter allocation_counter_ = nullptr;
+
+    // Calls run_query(index) for every query on the pool and waits for the whole batch
+    template <typename RunQuery>
+    void RunBatch(size_t query_count, RunQuery run_query);
+};
+
+// Shared executor with one thread per hardware thread, created on first use
+QueryExecutor& GetDefaultQueryExecutor();
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
@@ -10,3 +78,6 @@ std::vector <Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
+std::vector<std::vector<Document>> ProcessQueries(
+    QueryCache& query_cache,
+    const std::vector<std::string>& queries);
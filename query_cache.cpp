@@ -0,0 +1,112 @@
+#include "query_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+QueryCache::QueryCache(const SearchServer& search_server, size_t capacity, size_t shard_count)
+    : search_server_(search_server)
+    , shards_(max<size_t>(1, min(shard_count, capacity))) {
+    // The first capacity % shard count shards take one entry more
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+    }
+}
+
+vector<Document> QueryCache::FindTopDocuments(const string_view raw_query, DocumentStatus status, size_t top_count) {
+    SearchServer::Query& query = SearchServer::GetThreadQuery();
+    search_server_.ParseQuery(raw_query, query);
+    thread_local string key;
+    BuildKey(query, status, top_count, key);
+
+    const uint64_t generation = search_server_.GetGeneration();
+    Shard& shard = shards_[hash<string_view>{}(key) % shards_.size()];
+    vector<Document> documents;
+    if (Find(shard, key, generation, documents)) {
+        ++hits_;
+        return documents;
+    }
+    ++misses_;
+
+    TopDocuments top_documents(top_count);
+    search_server_.FindAllDocuments(query, SearchServer::StatusFilter{ status }, top_documents);
+    documents = top_documents.Release();
+    Insert(shard, key, generation, documents);
+    return documents;
+}
+
+const SearchServer& QueryCache::GetSearchServer() const {
+    return search_server_;
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+    return { hits_, misses_, evictions_, invalidations_ };
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        lock_guard guard(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+void QueryCache::BuildKey(const SearchServer::Query& query, DocumentStatus status, size_t top_count, string& key) {
+    // Words never contain spaces and plus words never start with '-', so the key is unambiguous
+    key = to_string(static_cast<int>(status));
+    key += ' ';
+    key += to_string(top_count);
+    for (const string_view word : query.plus_words) {
+        key += ' ';
+        key += word;
+    }
+    for (const string_view word : query.minus_words) {
+        key += " -"sv;
+        key += word;
+    }
+}
+
+bool QueryCache::Find(Shard& shard, const string& key, uint64_t generation, vector<Document>& documents) {
+    lock_guard guard(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return false;
+    }
+    const auto entry = it->second;
+    if (entry->generation != generation) {
+        shard.index.erase(it);
+        shard.entries.erase(entry);
+        ++invalidations_;
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    documents = entry->documents;
+    return true;
+}
+
+void QueryCache::Insert(Shard& shard, const string& key, uint64_t generation, const vector<Document>& documents) {
+    if (shard.capacity == 0) {
+        return;
+    }
+    lock_guard guard(shard.mutex);
+    // Another thread may have computed the same query meanwhile
+    const auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Generations only grow, so a result computed for an older index is dropped
+        if (it->second->generation > generation) {
+            return;
+        }
+        it->second->generation = generation;
+        it->second->documents = documents;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    shard.entries.push_front({ key, generation, documents });
+    shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+    if (shard.entries.size() > shard.capacity) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+        ++evictions_;
+    }
+}
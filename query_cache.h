@@ -0,0 +1,80 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    // Entries found but computed before documents were added or removed
+    uint64_t invalidations = 0;
+};
+
+// Bounded LRU cache of FindTopDocuments results of one SearchServer. Entries are keyed by the
+// parsed query (sorted and deduplicated plus and minus words without stop words), the status
+// and top_count, so differently written forms of one query share an entry. Every entry keeps
+// the index generation it was computed for and is recomputed once documents are added or
+// removed. Results for arbitrary predicates are not cached. Lookups may come from any number
+// of threads; entries are spread over independently locked shards, each with its own LRU order.
+class QueryCache {
+public:
+    // capacity 0 disables caching, lookups are then counted as misses. The shard count is
+    // lowered to the capacity, so the shards together hold exactly capacity entries.
+    explicit                                QueryCache(const SearchServer& search_server, size_t capacity = 1024,
+        size_t shard_count = 16);
+
+                                            QueryCache(const QueryCache&) = delete;
+    QueryCache&                             operator=(const QueryCache&) = delete;
+
+    std::vector<Document>                   FindTopDocuments(const std::string_view raw_query,
+        DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    const SearchServer&                     GetSearchServer() const;
+
+    QueryCacheStats                         GetStats() const;
+
+    void                                    Clear();
+
+private:
+    struct Entry {
+        std::string                         key;
+        uint64_t                            generation;
+        std::vector<Document>               documents;
+    };
+
+    struct Shard {
+        std::mutex                          mutex;
+        size_t                              capacity = 0;
+        // Most recently used first
+        std::list<Entry>                    entries;
+        // Keys point into the entries
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    const SearchServer&                     search_server_;
+    std::vector<Shard>                      shards_;
+
+    std::atomic<uint64_t>                   hits_ = 0;
+    std::atomic<uint64_t>                   misses_ = 0;
+    std::atomic<uint64_t>                   evictions_ = 0;
+    std::atomic<uint64_t>                   invalidations_ = 0;
+
+    static void                             BuildKey(const SearchServer::Query& query, DocumentStatus status,
+        size_t top_count, std::string& key);
+
+    // Copies the cached result into documents if it is up to date
+    bool                                    Find(Shard& shard, const std::string& key, uint64_t generation,
+        std::vector<Document>& documents);
+
+    void                                    Insert(Shard& shard, const std::string& key, uint64_t generation,
+        const std::vector<Document>& documents);
+};
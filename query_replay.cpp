@@ -0,0 +1,84 @@
+#include "query_replay.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+QueryReplayReport ReplayQueries(const SearchServer& search_server, const string& path,
+    const QueryReplayOptions& options) {
+    if (options.batch_size == 0) {
+        throw invalid_argument("Batch size must be positive"s);
+    }
+    MappedFile file(path);
+    QueryExecutor executor(options.thread_count);
+    executor.SetAllocationCounter(options.allocation_counter);
+    QueryReplayReport report;
+    report.thread_count = executor.GetThreadCount();
+    report.batch_size = options.batch_size;
+    report.allocations_counted = executor.HasAllocationCounter();
+
+    // Strings of the batch keep their buffers from one batch to the next
+    vector<string> batch;
+    const char* data = file.data();
+    const size_t size = file.size();
+    size_t pos = 0;
+    const auto start = chrono::steady_clock::now();
+    while (pos < size) {
+        size_t count = 0;
+        while (count < options.batch_size && pos < size) {
+            const char* line_end = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+            const size_t end = line_end == nullptr ? size : line_end - data;
+            string_view line(data + pos, end - pos);
+            pos = line_end == nullptr ? size : end + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (count == batch.size()) {
+                batch.emplace_back();
+            }
+            batch[count++].assign(line.data(), line.size());
+        }
+        batch.resize(count);
+        for (const vector<Document>& documents : executor.ProcessQueries(search_server, batch)) {
+            report.document_count += documents.size();
+        }
+        file.Release(pos);
+    }
+    report.duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+
+    report.latency = executor.GetLatencyStats();
+    report.query_count = report.latency.query_count;
+    if (report.duration.count() > 0) {
+        report.queries_per_second = report.query_count * 1e6 / report.duration.count();
+    }
+    return report;
+}
+
+void PrintReportJson(ostream& out, const QueryReplayReport& report) {
+    const QueryLatencyStats& latency = report.latency;
+    out << "{\"threads\":"s << report.thread_count
+        << ",\"batch_size\":"s << report.batch_size
+        << ",\"queries\":"s << report.query_count
+        << ",\"documents\":"s << report.document_count
+        << ",\"duration_us\":"s << report.duration.count()
+        << ",\"qps\":"s << static_cast<uint64_t>(report.queries_per_second)
+        << ",\"p50_us\":"s << latency.p50.count()
+        << ",\"p95_us\":"s << latency.p95.count()
+        << ",\"p99_us\":"s << latency.p99.count()
+        << ",\"p999_us\":"s << latency.p999.count();
+    if (report.allocations_counted) {
+        out << ",\"allocations\":"s << latency.allocation_count
+            << ",\"allocations_per_query\":"s << (report.query_count == 0 ? 0.0 : static_cast<double>(latency.allocation_count) / report.query_count);
+    }
+    else {
+        out << ",\"allocations\":null,\"allocations_per_query\":null"s;
+    }
+    out << "}\n"s;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "process_queries.h"
+#include "search_server.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+struct QueryReplayOptions {
+    // 0 means hardware concurrency
+    size_t                          thread_count = 0;
+    // Must be positive
+    size_t                          batch_size = 1024;
+    // Counts allocations of the replayed queries, e.g. GetThreadAllocationCount from
+    // allocation_counter.h. nullptr leaves them uncounted.
+    AllocationCounter               allocation_counter = nullptr;
+};
+
+struct QueryReplayReport {
+    size_t                          thread_count = 0;
+    size_t                          batch_size = 0;
+    uint64_t                        query_count = 0;
+    // Documents found by all queries together
+    uint64_t                        document_count = 0;
+    std::chrono::microseconds       duration{};
+    double                          queries_per_second = 0.0;
+    QueryLatencyStats               latency;
+    bool                            allocations_counted = false;
+};
+
+// Runs a query log, one query per line, against the server in batches of batch_size through a
+// QueryExecutor with thread_count threads. The log is mapped into memory and only one batch of
+// queries is copied out of it at a time, so logs larger than memory can be replayed. An invalid
+// query or a batch_size of 0 stops the replay with invalid_argument.
+QueryReplayReport ReplayQueries(const SearchServer& search_server, const std::string& path,
+    const QueryReplayOptions& options = {});
+
+// Writes the report as a single line of JSON, so runs can be appended to one file and compared.
+// Allocation fields are null when allocations were not counted.
+void PrintReportJson(std::ostream& out, const QueryReplayReport& report);
@@ -0,0 +1,25 @@
+#include "relevance_accumulator.h"
+
+using namespace std;
+
+void RelevanceAccumulator::Reset(size_t document_count) {
+    for (const int ordinal : touched_) {
+        relevances_[ordinal] = 0.0;
+        states_[ordinal] = State::UNTOUCHED;
+    }
+    touched_.clear();
+    if (relevances_.size() < document_count) {
+        relevances_.resize(document_count, 0.0);
+        states_.resize(document_count, State::UNTOUCHED);
+    }
+}
+
+const vector<int>& RelevanceAccumulator::GetTouched() const {
+    return touched_;
+}
+
+RelevanceAccumulator& GetThreadRelevanceAccumulator(size_t document_count) {
+    thread_local RelevanceAccumulator accumulator;
+    accumulator.Reset(document_count);
+    return accumulator;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RelevanceAccumulator {
+public:
+    void                        Reset(size_t document_count);
+
+    void                        Add(int ordinal, double relevance);
+
+    const std::vector<int>&     GetTouched() const;
+
+    double                      GetRelevance(int ordinal) const;
+
+private:
+    enum class State : uint8_t {
+        UNTOUCHED,
+        MATCHED,
+    };
+
+    std::vector<double>         relevances_;
+    std::vector<State>          states_;
+    std::vector<int>            touched_;
+};
+
+// One accumulator per thread, reused across queries to avoid allocations
+RelevanceAccumulator& GetThreadRelevanceAccumulator(size_t document_count);
+
+inline void RelevanceAccumulator::Add(int ordinal, double relevance) {
+    State& state = states_[ordinal];
+    if (state == State::UNTOUCHED) {
+        state = State::MATCHED;
+        touched_.push_back(ordinal);
+    }
+    relevances_[ordinal] += relevance;
+}
+
+inline double RelevanceAccumulator::GetRelevance(int ordinal) const {
+    return relevances_[ordinal];
+}
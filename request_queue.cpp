@@ -5,19 +5,29 @@ using namespace std;
 RequestQueue::RequestQueue(const SearchServer& search_server)
     : search_server_(search_server) {}
 
+RequestQueue::RequestQueue(QueryCache& query_cache)
+    : search_server_(query_cache.GetSearchServer())
+    , query_cache_(&query_cache) {}
+
 RequestQueue::FindResult RequestQueue::AddFindRequest(const string& raw_query,
     DocumentStatus status) {
-    const auto documents = search_server_.FindTopDocuments(raw_query, status);
+    const auto documents = query_cache_ ? query_cache_->FindTopDocuments(raw_query, status)
+        : search_server_.FindTopDocuments(raw_query, status);
     AddRequest(documents.size());
     return documents;
 }
 
 RequestQueue::FindResult RequestQueue::AddFindRequest(const string& raw_query) {
-    const auto documents = search_server_.FindTopDocuments(raw_query);
+    const auto documents = query_cache_ ? query_cache_->FindTopDocuments(raw_query)
+        : search_server_.FindTopDocuments(raw_query);
     AddRequest(documents.size());
     return documents;
 }
 
+void RequestQueue::AddFindResult(const FindResult& result) {
+    AddRequest(result.size());
+}
+
 int RequestQueue::GetNoResultRequests() const {
     return no_result_requests_;
 }
@@ -6,12 +6,16 @@
 #include <vector>
 
 #include "document.h"
+#include "query_cache.h"
 #include "search_server.h"
 
 class RequestQueue {
 public:
                                             RequestQueue(const SearchServer& search_server);
 
+    // Requests by status are answered from query_cache, which must outlive the queue
+                                            RequestQueue(QueryCache& query_cache);
+
     using FindResult = std::vector<Document>;
 
     template <typename DocumentPredicate>
@@ -23,6 +27,9 @@ public:
 
     FindResult                                      AddFindRequest(const std::string& raw_query);
 
+    // Records a request whose result was computed elsewhere, e.g. by AsyncSearchServer
+    void                                            AddFindResult(const FindResult& result);
+
     int                                             GetNoResultRequests() const;
 
 private:
@@ -34,6 +41,7 @@ private:
 private:
     std::deque<QueryResult>                         requests_;
     const SearchServer& search_server_;
+    QueryCache*                                     query_cache_ = nullptr;
     int                                             no_result_requests_ = 0;
     uint64_t                                        current_time_ = 0;
     const static int                                minute_in_day_ = 1440;
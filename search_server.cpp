@@ -1,60 +1,285 @@
 #include "search_server.h"
+#include "mapped_file.h"
 
+#include <atomic>
 #include <numeric>
+#include <thread>
 
 void SearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
-    if (!IsValidWord(document)) {
-        throw invalid_argument("Document contains special symbols"s);
-    }
-    else if (document_id < 0 || documents_.count(document_id)) {
+    if (document_id < 0 || documents_.Contains(document_id)) {
         throw invalid_argument("Document_id is negative or already exist"s);
     }
 
     const auto words = SplitIntoWordsNoStop(document);
     const double inv_word_count = 1.0 / words.size();
+    const int ordinal = static_cast<int>(documents_.GetOrdinalCount());
 
+    map<string_view, double> word_freqs;
     for (const auto& word : words) {
-        auto [a, b] = words_.emplace(word);
-        string_view word_view = *a;
-        word_to_document_freqs_[word_view][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word_view] += inv_word_count;
+        word_freqs[InternWord(word)] += inv_word_count;
+    }
 
+    for (const auto [word, term_freq] : word_freqs) {
+        Term& term = terms_[GetOrAddTermId(word)];
+        // Ordinals only grow, so appending keeps posting lists sorted
+        term.postings.Append(ordinal, term_freq);
+        UpdateLogDocumentFreq(term);
     }
-    documents_.emplace(document_id,
-        DocumentData{
-            ComputeAverageRating(ratings),
-            status
+    AddToForwardIndex(document_id, word_freqs);
+    documents_.Add(document_id, status, ComputeAverageRating(ratings));
+    UpdateLogDocumentCount();
+    generation_ = NewGeneration();
+}
+
+void SearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    AddDocuments(execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const execution::sequenced_policy&, const vector<RawDocument>& documents) {
+    AddDocumentBatch(execution::seq, PrepareDocumentBatch(execution::seq, documents));
+}
+
+void SearchServer::AddDocuments(const execution::parallel_policy&, const vector<RawDocument>& documents) {
+    AddDocumentBatch(execution::par, PrepareDocumentBatch(execution::par, documents));
+}
+
+SearchServer::DocumentBatch SearchServer::PrepareDocuments(const execution::parallel_policy&,
+    const vector<RawDocument>& documents) const {
+    return PrepareDocumentBatch(execution::par, documents);
+}
+
+void SearchServer::AddPreparedDocuments(const execution::parallel_policy&, const DocumentBatch& batch) {
+    AddDocumentBatch(execution::par, batch);
+}
+
+template <typename ExecutionPolicy>
+SearchServer::DocumentBatch SearchServer::PrepareDocumentBatch(ExecutionPolicy&& policy,
+    const vector<RawDocument>& documents) const {
+    CheckNewDocumentIds(documents);
+
+    // Exceptions must not escape a parallel algorithm, so invalid documents are only marked
+    // here and reported afterwards
+    DocumentBatch batch;
+    batch.documents = &documents;
+    batch.document_words.resize(documents.size());
+    vector<char> is_invalid(documents.size(), false);
+    vector<size_t> indexes(documents.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(policy, indexes.begin(), indexes.end(),
+        [&](size_t index) {
+            vector<string_view> words;
+            try {
+                words = SplitIntoWordsNoStop(documents[index].text);
+            }
+            catch (const invalid_argument&) {
+                is_invalid[index] = true;
+                return;
+            }
+            const double inv_word_count = 1.0 / words.size();
+            sort(words.begin(), words.end());
+            vector<pair<string_view, double>>& word_freqs = batch.document_words[index];
+            for (const string_view word : words) {
+                if (word_freqs.empty() || word_freqs.back().first != word) {
+                    word_freqs.push_back({ word, 0.0 });
+                }
+                word_freqs.back().second += inv_word_count;
+            }
         });
-    document_ids_.insert(document_id);
+    if (any_of(is_invalid.begin(), is_invalid.end(), [](char invalid) { return invalid; })) {
+        throw invalid_argument("Document contains special symbols"s);
+    }
+    return batch;
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::AddDocumentBatch(ExecutionPolicy&& policy, const DocumentBatch& batch) {
+    const vector<RawDocument>& documents = *batch.documents;
+    const auto& document_words = batch.document_words;
+    vector<size_t> indexes(documents.size());
+    iota(indexes.begin(), indexes.end(), 0);
+
+    // Every chunk of consecutive documents builds its own partial inverted index
+    constexpr bool is_parallel = is_same_v<decay_t<ExecutionPolicy>, execution::parallel_policy>;
+    const int first_ordinal = static_cast<int>(documents_.GetOrdinalCount());
+    const size_t chunk_count = is_parallel ? max<size_t>(1, min(GetParallelShardCount(), documents.size())) : 1;
+    vector<unordered_map<string_view, vector<Posting>>> chunk_postings(chunk_count);
+    vector<size_t> chunks(chunk_count);
+    iota(chunks.begin(), chunks.end(), 0);
+    for_each(policy, chunks.begin(), chunks.end(),
+        [&](size_t chunk) {
+            const size_t first = documents.size() * chunk / chunk_count;
+            const size_t last = documents.size() * (chunk + 1) / chunk_count;
+            for (size_t index = first; index < last; ++index) {
+                const int ordinal = first_ordinal + static_cast<int>(index);
+                for (const auto& [word, term_freq] : document_words[index]) {
+                    chunk_postings[chunk][word].push_back({ ordinal, term_freq });
+                }
+            }
+        });
+
+    // Chunks hold increasing ordinal ranges, so merging them in order keeps posting lists sorted
+    vector<size_t> changed_term_ids;
+    for (auto& postings_by_word : chunk_postings) {
+        for (auto& [word, postings] : postings_by_word) {
+            const size_t term_id = GetOrAddTermId(InternWord(word));
+            PostingList& term_postings = terms_[term_id].postings;
+            if (term_postings.GetLastOrdinal() < first_ordinal) {
+                changed_term_ids.push_back(term_id);
+            }
+            for (const Posting& posting : postings) {
+                term_postings.Append(posting.ordinal, posting.term_freq);
+            }
+        }
+    }
+    for (const size_t term_id : changed_term_ids) {
+        UpdateLogDocumentFreq(terms_[term_id]);
+    }
+
+    // Tree nodes are the costly part of the MAP forward index, so they are built in parallel
+    vector<map<string_view, double>> forward_index;
+    if (options_.forward_index == ForwardIndexMode::MAP) {
+        forward_index.resize(documents.size());
+        for_each(policy, indexes.begin(), indexes.end(),
+            [&](size_t index) {
+                for (const auto& [word, term_freq] : document_words[index]) {
+                    forward_index[index].emplace_hint(forward_index[index].end(), word_to_term_id_.find(word)->first, term_freq);
+                }
+            });
+    }
+
+    for (size_t index = 0; index < documents.size(); ++index) {
+        const RawDocument& document = documents[index];
+        if (options_.forward_index == ForwardIndexMode::MAP) {
+            document_to_word_freqs_.emplace(document.id, move(forward_index[index]));
+        }
+        else {
+            AddToForwardIndex(document.id, document_words[index]);
+        }
+        documents_.Add(document.id, document.status, ComputeAverageRating(document.ratings));
+    }
+    UpdateLogDocumentCount();
+    generation_ = NewGeneration();
 }
 
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
-set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+DocumentStore::Iterator SearchServer::begin() const {
+    return documents_.begin();
 }
 
-set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+DocumentStore::Iterator SearchServer::end() const {
+    return documents_.end();
 }
 
 const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
     static const map<string_view, double> empty_words = {};
-
-    if (document_to_word_freqs_.count(document_id)) {
+    const int ordinal = documents_.FindOrdinal(document_id);
+    if (ordinal < 0) {
+        return empty_words;
+    }
+    thread_local map<string_view, double> word_freqs;
+    switch (options_.forward_index) {
+    case ForwardIndexMode::MAP:
         return document_to_word_freqs_.at(document_id);
+    case ForwardIndexMode::COMPACT:
+        word_freqs.clear();
+        for (size_t i = document_term_offsets_[ordinal]; i < document_term_offsets_[ordinal + 1]; ++i) {
+            const Term& term = terms_[document_term_ids_[i]];
+            word_freqs.emplace(term.word, FindTermFreq(term.postings, ordinal).value_or(0.0));
+        }
+        break;
+    case ForwardIndexMode::NONE:
+        word_freqs.clear();
+        for (const Term& term : terms_) {
+            if (const optional<double> term_freq = FindTermFreq(term.postings, ordinal)) {
+                word_freqs.emplace(term.word, *term_freq);
+            }
+        }
+        break;
     }
-    else {
-        return empty_words;
+    return word_freqs;
+}
+
+template <typename WordFreqs>
+void SearchServer::AddToForwardIndex(int document_id, const WordFreqs& word_freqs) {
+    switch (options_.forward_index) {
+    case ForwardIndexMode::MAP: {
+        map<string_view, double>& document_word_freqs = document_to_word_freqs_[document_id];
+        for (const auto& [word, term_freq] : word_freqs) {
+            document_word_freqs.emplace_hint(document_word_freqs.end(), word_to_term_id_.find(word)->first, term_freq);
+        }
+        break;
+    }
+    case ForwardIndexMode::COMPACT: {
+        const size_t first = document_term_ids_.size();
+        for (const auto& [word, term_freq] : word_freqs) {
+            document_term_ids_.push_back(static_cast<uint32_t>(word_to_term_id_.find(word)->second));
+        }
+        sort(document_term_ids_.MutableData() + first, document_term_ids_.MutableData() + document_term_ids_.size());
+        document_term_offsets_.push_back(document_term_ids_.size());
+        break;
+    }
+    case ForwardIndexMode::NONE:
+        break;
+    }
+}
+
+optional<double> SearchServer::FindTermFreq(const PostingList& postings, int ordinal) {
+    PostingList::Cursor cursor = postings.GetCursor();
+    cursor.NextGeq(ordinal);
+    if (cursor.GetOrdinal() != ordinal) {
+        return nullopt;
     }
+    return cursor.GetTermFreq();
+}
+
+IndexMemoryStats SearchServer::GetMemoryStats() const {
+    IndexMemoryStats stats;
+    for (const Term& term : terms_) {
+        stats.posting_count += term.postings.size();
+        stats.posting_bytes += term.postings.GetMemoryUsage();
+        stats.removed_posting_count += term.removed_postings;
+    }
+    const size_t tree_node_overhead = 4 * sizeof(void*);
+    for (const auto& [document_id, word_freqs] : document_to_word_freqs_) {
+        stats.forward_index_bytes += tree_node_overhead + sizeof(document_id) + sizeof(word_freqs)
+            + word_freqs.size() * (tree_node_overhead + sizeof(pair<const string_view, double>));
+    }
+    stats.forward_index_bytes += document_term_ids_.GetMemoryUsage() + document_term_offsets_.GetMemoryUsage();
+    stats.document_bytes = documents_.GetMemoryUsage();
+    stats.mapped_file_bytes = mapped_file_ ? mapped_file_->size() : 0;
+    lock_guard guard(words_->mutex);
+    stats.interned_word_count = words_->words.GetStringCount();
+    stats.interned_word_bytes = words_->words.GetStringBytes();
+    stats.word_storage_bytes = words_->words.GetMemoryUsage();
+    return stats;
+}
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+uint64_t SearchServer::NewGeneration() {
+    static atomic<uint64_t> last_generation = 0;
+    return ++last_generation;
 }
 
 bool SearchServer::IsStopWord(const string_view word) const {
     return stop_words_.count(word) > 0;
 }
 
+string_view SearchServer::InternWord(const string_view word) {
+    // Dictionary keys are already interned, so the storage lock is only taken for new words
+    const auto it = word_to_term_id_.find(word);
+    if (it != word_to_term_id_.end()) {
+        return it->first;
+    }
+    lock_guard guard(words_->mutex);
+    return words_->words.Intern(word);
+}
+
 bool SearchServer::IsValidWord(const string_view word) {
     // A valid word must not contain special characters
     return none_of(word.begin(), word.end(), [](char c) {
@@ -64,17 +289,59 @@ bool SearchServer::IsValidWord(const string_view word) {
 
 vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view text) const {
     vector<string_view> words;
-    for (const string_view word : SplitIntoWordsView(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word  is invalid"s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
+    if (!SplitIntoWordsChecked(text, words)) {
+        throw invalid_argument("Document contains special symbols"s);
     }
+    words.erase(remove_if(words.begin(), words.end(), [this](string_view word) { return IsStopWord(word); }),
+        words.end());
     return words;
 }
 
+const SearchServer::Term* SearchServer::FindTerm(const string_view word) const {
+    const auto it = word_to_term_id_.find(word);
+    if (it == word_to_term_id_.end()) {
+        return nullptr;
+    }
+    return &terms_[it->second];
+}
+
+bool SearchServer::ContainsPosting(const string_view word, int ordinal) const {
+    const Term* term = FindTerm(word);
+    if (term == nullptr) {
+        return false;
+    }
+    return term->postings.Contains(ordinal);
+}
+
+size_t SearchServer::GetOrAddTermId(const string_view word) {
+    auto [it, inserted] = word_to_term_id_.emplace(word, terms_.size());
+    if (inserted) {
+        terms_.push_back({ PostingList(options_.compress_postings), 0.0, 0, word });
+    }
+    return it->second;
+}
+
+void SearchServer::UpdateLogDocumentFreq(Term& term) {
+    const size_t document_freq = term.postings.size() - term.removed_postings;
+    term.log_document_freq = document_freq == 0 ? 0.0 : log(static_cast<double>(document_freq));
+}
+
+size_t SearchServer::GetParallelShardCount() const {
+    if (options_.parallel_shard_count > 0) {
+        return options_.parallel_shard_count;
+    }
+    return max(1u, thread::hardware_concurrency());
+}
+
+void SearchServer::CheckNewDocumentIds(const vector<RawDocument>& documents) const {
+    set<int> batch_ids;
+    for (const RawDocument& document : documents) {
+        if (document.id < 0 || documents_.Contains(document.id) || !batch_ids.insert(document.id).second) {
+            throw invalid_argument("Document_id is negative or already exist"s);
+        }
+    }
+}
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -97,116 +364,326 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     };
 }
 
-SearchServer::Query SearchServer::ParseQueryPar(const string_view raw_query) const {
-    Query result;
-    for (std::string_view word : SplitIntoWordsView(raw_query)) {
-        QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            query_word.is_minus ? result.minus_words.insert(query_word.data) : result.plus_words.insert(query_word.data);
+SearchServer::Query& SearchServer::GetThreadQuery() {
+    thread_local Query query;
+    return query;
+}
 
+void SearchServer::AddMinusWordOrdinals(const Query& query, OrdinalSet& excluded) const {
+    for (const string_view word : query.minus_words) {
+        const Term* term = FindTerm(word);
+        if (term == nullptr) {
+            continue;
         }
+        term->postings.ForEach([&excluded](int ordinal, double) {
+            excluded.Insert(ordinal);
+        });
     }
-    return result;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const string_view raw_query) const {
+SearchServer::MaxScoreState& SearchServer::GetThreadMaxScoreState() {
+    thread_local MaxScoreState state;
+    return state;
+}
 
-    if (!IsValidWord(raw_query)) {
-        throw invalid_argument("Query contains special symbols"s);
+bool SearchServer::IsMaxScoreQuery(const Query& query) const {
+    if (!options_.max_score_pruning || query.plus_words.size() > MAX_SCORE_MAX_PLUS_WORDS) {
+        return false;
     }
-    else if (raw_query.find("--"s) != string::npos) {
-        throw invalid_argument("Query contains double-minus"s);
+    size_t min_length = numeric_limits<size_t>::max();
+    size_t max_length = 0;
+    for (const string_view word : query.plus_words) {
+        const Term* term = FindTerm(word);
+        if (term != nullptr && !term->postings.empty()) {
+            min_length = min(min_length, term->postings.size());
+            max_length = max(max_length, term->postings.size());
+        }
     }
-    else if (raw_query.find("- "s) != string::npos) {
-        throw invalid_argument("No word after '-' symbol"s);
+    return max_length > 0 && max_length >= MAX_SCORE_MIN_LENGTH_RATIO * min_length;
+}
+
+SearchServer::BatchState& SearchServer::GetThreadBatchState() {
+    thread_local BatchState state;
+    return state;
+}
+
+void SearchServer::FindAllDocumentsBatch(const vector<const Query*>& queries, const vector<DocumentStatus>& statuses,
+    vector<TopDocuments>& top_documents) const {
+    BatchState& state = GetThreadBatchState();
+    // Identical queries are scored once, the others copy the result of the first one
+    state.representatives.clear();
+    for (size_t query = 0; query < queries.size(); ++query) {
+        size_t representative = 0;
+        while (representative < query && !(statuses[representative] == statuses[query]
+            && queries[representative]->plus_words == queries[query]->plus_words
+            && queries[representative]->minus_words == queries[query]->minus_words)) {
+            ++representative;
+        }
+        state.representatives.push_back(representative);
     }
-    else if (raw_query[size(raw_query) - 1] == '-') {
-        throw invalid_argument("No word after '-' symbol"s);
+    const auto is_scored = [&state](size_t query) { return state.representatives[query] == query; };
+
+    state.word_queries.clear();
+    for (size_t query = 0; query < queries.size(); ++query) {
+        if (is_scored(query)) {
+            for (const string_view word : queries[query]->plus_words) {
+                state.word_queries.push_back({ word, query });
+            }
+        }
+    }
+    sort(state.word_queries.begin(), state.word_queries.end());
+    size_t distinct_word_count = 0;
+    for (size_t i = 0; i < state.word_queries.size(); ++i) {
+        if (i == 0 || state.word_queries[i].first != state.word_queries[i - 1].first) {
+            ++distinct_word_count;
+        }
     }
 
-    Query query;
-    for (const auto word : SplitIntoWordsView(raw_query)) {
+    // Walking shared postings once only beats scoring every query on its own
+    // when a word is used by several queries on average
+    if (state.word_queries.size() < BATCH_MIN_QUERIES_PER_WORD * distinct_word_count) {
+        for (size_t query = 0; query < queries.size(); ++query) {
+            if (is_scored(query)) {
+                FindAllDocuments(*queries[query], StatusFilter{ statuses[query] }, top_documents[query]);
+            }
+        }
+    }
+    else {
+        FindAllDocumentsTermAtATime(queries, statuses, top_documents);
+    }
+
+    for (size_t query = 0; query < queries.size(); ++query) {
+        if (!is_scored(query)) {
+            top_documents[query] = top_documents[state.representatives[query]];
+        }
+    }
+}
+
+void SearchServer::FindAllDocumentsTermAtATime(const vector<const Query*>& queries, const vector<DocumentStatus>& statuses,
+    vector<TopDocuments>& top_documents) const {
+    BatchState& state = GetThreadBatchState();
+    if (state.accumulators.size() < queries.size()) {
+        state.accumulators.resize(queries.size());
+        state.excluded.resize(queries.size());
+    }
+    for (size_t query = 0; query < queries.size(); ++query) {
+        state.accumulators[query].Reset(documents_.GetOrdinalCount());
+        state.excluded[query].Reset(documents_.GetOrdinalCount());
+        if (state.representatives[query] == query) {
+            AddMinusWordOrdinals(*queries[query], state.excluded[query]);
+        }
+    }
+
+    for (auto first = state.word_queries.begin(); first != state.word_queries.end();) {
+        const auto last = find_if(first, state.word_queries.end(),
+            [word = first->first](const auto& word_query) { return word_query.first != word; });
+        const Term* term = FindTerm(first->first);
+        if (term != nullptr && !term->postings.empty()) {
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(*term);
+            term->postings.ForEach([&](int ordinal, double term_freq) {
+                if (IsRemovedOrdinal(ordinal)) {
+                    return;
+                }
+                const DocumentStatus status = documents_.GetStatus(ordinal);
+                const double relevance = term_freq * inverse_document_freq;
+                for (auto it = first; it != last; ++it) {
+                    const size_t query = it->second;
+                    if (statuses[query] == status && !state.excluded[query].Contains(ordinal)) {
+                        state.accumulators[query].Add(ordinal, relevance);
+                    }
+                }
+            });
+        }
+        first = last;
+    }
+
+    // Duplicate queries have no words in word_queries, so their accumulators stay empty
+    for (size_t query = 0; query < queries.size(); ++query) {
+        const RelevanceAccumulator& accumulator = state.accumulators[query];
+        for (const int ordinal : accumulator.GetTouched()) {
+            top_documents[query].Add({
+                documents_.GetDocumentId(ordinal),
+                accumulator.GetRelevance(ordinal),
+                documents_.GetRating(ordinal)
+                });
+        }
+    }
+}
+
+void SearchServer::ParseQueryPar(const string_view raw_query, Query& query) const {
+    query.words.clear();
+    SplitIntoWordsChecked(raw_query, query.words);
+    AddQueryWords(query);
+}
+
+void SearchServer::ParseQuery(const string_view raw_query, Query& query) const {
+    query.words.clear();
+    if (!SplitIntoWordsChecked(raw_query, query.words)) {
+        throw invalid_argument("Query contains special symbols"s);
+    }
+    for (const string_view word : query.words) {
+        if (word.find("--"sv) != string_view::npos) {
+            throw invalid_argument("Query contains double-minus"s);
+        }
+        else if (word.back() == '-') {
+            throw invalid_argument("No word after '-' symbol"s);
+        }
+    }
+    AddQueryWords(query);
+}
+
+void SearchServer::AddQueryWords(Query& query) const {
+    query.plus_words.clear();
+    query.minus_words.clear();
+    query.plus_word_idfs.clear();
+    for (const string_view word : query.words) {
         const QueryWord query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.insert(query_word.data);
-            }
-            else {
-                query.plus_words.insert(query_word.data);
-            }
+            (query_word.is_minus ? query.minus_words : query.plus_words).push_back(query_word.data);
         }
     }
+    for (vector<string_view>* words : { &query.plus_words, &query.minus_words }) {
+        sort(words->begin(), words->end());
+        words->erase(unique(words->begin(), words->end()), words->end());
+    }
+}
 
-    return query;
+double  SearchServer::ComputeWordInverseDocumentFreq(const Term& term) const {
+    return log_document_count_ - term.log_document_freq;
 }
 
-double  SearchServer::ComputeWordInverseDocumentFreq(const string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::GetInverseDocumentFreq(const Query& query, size_t plus_word_index, const Term& term) const {
+    if (query.plus_word_idfs.empty()) {
+        return ComputeWordInverseDocumentFreq(term);
+    }
+    return query.plus_word_idfs[plus_word_index];
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    for (auto [word, freq] : document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
+size_t SearchServer::GetDocumentFreq(const string_view word) const {
+    const Term* term = FindTerm(word);
+    if (term == nullptr) {
+        return 0;
     }
-    document_to_word_freqs_.erase(document_id);
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    return term->postings.size() - term->removed_postings;
+}
+
+void SearchServer::UpdateLogDocumentCount() {
+    log_document_count_ = documents_.empty() ? 0.0 : log(static_cast<double>(documents_.size()));
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocuments(execution::seq, { document_id });
 }
 
 void SearchServer::RemoveDocument(const execution::sequenced_policy&, int document_id) {
-    for_each(execution::seq, document_to_word_freqs_.at(document_id).begin(), document_to_word_freqs_.at(document_id).end(),
-        [&, document_id](auto& el) { word_to_document_freqs_.at(el.first).erase(document_id); });
-    document_to_word_freqs_.erase(document_id);
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    RemoveDocuments(execution::seq, { document_id });
 }
 
 void SearchServer::RemoveDocument(const execution::parallel_policy&, int document_id) {
-    if (documents_.count(document_id) == 0) {
+    if (!documents_.Contains(document_id)) {
         return;
     }
-    std::map<std::string_view, double>& id_to_word = document_to_word_freqs_.at(document_id);
-    std::vector<const string_view*> words_for_erase(id_to_word.size());
-    std::transform(
-        std::execution::par,
-        id_to_word.begin(), id_to_word.end(), words_for_erase.begin(),
-        [](const auto& word) {
-            return &(word.first);
+    RemoveDocuments(execution::par, { document_id });
+}
+
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(const execution::sequenced_policy&, const vector<int>& document_ids) {
+    vector<size_t> term_ids = MarkDocumentsRemoved(document_ids);
+    RemoveMarkedDocuments(execution::seq, term_ids);
+}
+
+void SearchServer::RemoveDocuments(const execution::parallel_policy&, const vector<int>& document_ids) {
+    vector<size_t> term_ids = MarkDocumentsRemoved(document_ids);
+    RemoveMarkedDocuments(execution::par, term_ids);
+}
+
+void SearchServer::CompactPostings() {
+    CompactAllTerms(execution::seq);
+}
+
+void SearchServer::CompactPostings(const execution::parallel_policy&) {
+    CompactAllTerms(execution::par);
+}
+
+vector<size_t> SearchServer::MarkDocumentsRemoved(const vector<int>& document_ids) {
+    for (const int document_id : document_ids) {
+        if (!documents_.Contains(document_id)) {
+            throw out_of_range("Document out of range"s);
+        }
+    }
+    vector<size_t> term_ids;
+    const auto add_removed_postings = [this, &term_ids](size_t term_id, size_t count) {
+        Term& term = terms_[term_id];
+        term.removed_postings += count;
+        UpdateLogDocumentFreq(term);
+        term_ids.push_back(term_id);
+    };
+    OrdinalSet& removed = GetThreadOrdinalSet(documents_.GetOrdinalCount());
+    for (const int document_id : document_ids) {
+        if (!documents_.Contains(document_id)) {
+            // Listed twice in the batch
+            continue;
+        }
+        // The document stops matching right away, its postings are dropped by compaction
+        const int ordinal = documents_.Remove(document_id);
+        switch (options_.forward_index) {
+        case ForwardIndexMode::MAP:
+            for (const auto [word, term_freq] : document_to_word_freqs_.at(document_id)) {
+                add_removed_postings(word_to_term_id_.at(word), 1);
+            }
+            document_to_word_freqs_.erase(document_id);
+            break;
+        case ForwardIndexMode::COMPACT:
+            for (size_t i = document_term_offsets_[ordinal]; i < document_term_offsets_[ordinal + 1]; ++i) {
+                add_removed_postings(document_term_ids_[i], 1);
+            }
+            break;
+        case ForwardIndexMode::NONE:
+            removed.Insert(ordinal);
+            break;
         }
-    );
-    std::for_each(
-        std::execution::par,
-        words_for_erase.begin(), words_for_erase.end(),
-        [&](const auto& word) {
-            word_to_document_freqs_[*word].erase(document_id);
+        ++removed_document_count_;
+    }
+    if (options_.forward_index == ForwardIndexMode::NONE && !removed.empty()) {
+        for (size_t term_id = 0; term_id < terms_.size(); ++term_id) {
+            size_t count = 0;
+            terms_[term_id].postings.ForEach([&removed, &count](int ordinal, double) {
+                count += removed.Contains(ordinal);
+            });
+            if (count > 0) {
+                add_removed_postings(term_id, count);
+            }
         }
-    );
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
+    }
+    UpdateLogDocumentCount();
+    generation_ = NewGeneration();
+    return term_ids;
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy,
     const string_view raw_query, int document_id) const {
-    if (document_to_word_freqs_.count(document_id)) {
-        const Query query = ParseQueryPar(raw_query);
-        const map<std::string_view, double>& word_freqs = document_to_word_freqs_.at(document_id);
-        if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [&](auto& word) {
-            return word_freqs.count(word);
-            })) {
-            return { vector<std::string_view>{}, documents_.at(document_id).status };
-        }
-        vector<std::string_view> matched_words(query.plus_words.size(), ""s);
-        copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-            matched_words.begin(),
-            [&word_freqs](auto& word) {
-                return word_freqs.find(word) != word_freqs.end();
-            });
-        sort(std::execution::par, matched_words.begin(), matched_words.end());
-        auto it = upper_bound(matched_words.begin(), matched_words.end(), ""s);
-        matched_words.erase(matched_words.begin(), it);
-        return { matched_words, documents_.at(document_id).status };
+    // Words are probed in the posting lists, so matching does not depend on the forward index
+    const int ordinal = documents_.GetOrdinal(document_id);
+    Query& query = GetThreadQuery();
+    ParseQueryPar(raw_query, query);
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [&](auto& word) {
+        return ContainsPosting(word, ordinal);
+        })) {
+        return { vector<std::string_view>{}, documents_.GetStatus(ordinal) };
     }
-    return { vector<std::string_view>{}, documents_.at(document_id).status };
+    vector<std::string_view> matched_words(query.plus_words.size(), ""s);
+    copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
+        matched_words.begin(),
+        [&](auto& word) {
+            return ContainsPosting(word, ordinal);
+        });
+    sort(std::execution::par, matched_words.begin(), matched_words.end());
+    auto it = upper_bound(matched_words.begin(), matched_words.end(), ""s);
+    matched_words.erase(matched_words.begin(), it);
+    return { matched_words, documents_.GetStatus(ordinal) };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const
@@ -215,17 +692,14 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
+    Query& query = GetThreadQuery();
+    ParseQuery(raw_query, query);
     std::vector<std::string_view> matched_words;
-    if (documents_.count(document_id) == 0)
-    {
-        throw std::out_of_range("Document out of range");
-    }
+    const int ordinal = documents_.GetOrdinal(document_id);
     bool isMinus = false;
     for (const std::string_view word : query.minus_words)
     {
-        if (word_to_document_freqs_.count(word) > 0 &&
-            word_to_document_freqs_.at(word).count(document_id) > 0)
+        if (ContainsPosting(word, ordinal))
         {
             matched_words.clear();
             isMinus = true;
@@ -236,12 +710,11 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const str
     {
         for (const std::string_view word : query.plus_words)
         {
-            if (word_to_document_freqs_.count(word) > 0 &&
-                word_to_document_freqs_.at(word).count(document_id) > 0)
+            if (ContainsPosting(word, ordinal))
             {
                 matched_words.push_back(word);
             }
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, documents_.GetStatus(documents_.GetOrdinal(document_id)) };
 }
@@ -1,15 +1,24 @@
 #pragma once
 
 #include "document.h"
+#include "document_store.h"
 #include "string_processing.h"
 #include "log_duration.h"
-#include "concurrent_map.h"
-
+#include "top_documents.h"
+#include "relevance_accumulator.h"
+#include "ordinal_set.h"
+#include "posting_list.h"
+#include "mappable_array.h"
+#include "string_pool.h"
+
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <algorithm>
 #include <set>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <iostream>
@@ -17,6 +26,11 @@
 #include <utility>
 #include <execution>
 #include <tuple>
+#include <numeric>
+#include <optional>
+#include <limits>
+#include <climits>
+#include <type_traits>
 
 #include "document.h" 
 
@@ -27,74 +41,145 @@ static auto key_mapper = [](const Document& document) {
     return document.id;
 };
 
+// How the words of every document are kept for GetWordFrequencies and removal
+enum class ForwardIndexMode {
+    // Word frequency tree per document
+    MAP,
+    // Sorted term ids of all documents in one array, frequencies are read from the postings
+    COMPACT,
+    // Nothing is stored. The words of a document are found by probing every posting list, and
+    // RemoveDocuments scans all posting lists once per call.
+    NONE,
+};
+
+struct SearchServerOptions {
+    // Number of ordinal ranges scored concurrently by parallel queries, 0 means hardware concurrency
+    size_t parallel_shard_count = 0;
+    // Store posting lists delta/varint encoded with term frequencies quantized to 16 bits
+    bool compress_postings = false;
+    // Sequential queries with few plus words whose posting lists differ a lot in length evaluate
+    // documents one at a time and skip those that can not reach the top. Other queries use the
+    // dense accumulator, which is up to an order of magnitude faster for long queries.
+    bool max_score_pruning = true;
+    // Removal only marks documents removed. Their postings are compacted once they make up
+    // a quarter of the indexed documents, or on CompactPostings().
+    bool lazy_removal = false;
+    ForwardIndexMode forward_index = ForwardIndexMode::MAP;
+};
+
+struct IndexMemoryStats {
+    size_t posting_count = 0;
+    size_t posting_bytes = 0;
+    // Postings of lazily removed documents waiting for compaction
+    size_t removed_posting_count = 0;
+    // Estimated from the size of the tree nodes in MAP mode
+    size_t forward_index_bytes = 0;
+    // Metadata columns and the id to ordinal mapping
+    size_t document_bytes = 0;
+    // Distinct words and stop words in the shared word storage
+    size_t interned_word_count = 0;
+    size_t interned_word_bytes = 0;
+    size_t word_storage_bytes = 0;
+    // Size of the index file the server views arrays of, not counted above
+    size_t mapped_file_bytes = 0;
+};
+
+class MappedFile;
+
+enum class IndexLoadMode;
+
 class SearchServer {
 public:
 
     template <typename StringCollection>
-    explicit SearchServer(const StringCollection& stop_words) {
+    explicit SearchServer(const StringCollection& stop_words, const SearchServerOptions& options = {})
+        : options_(options) {
         for (const auto& word : stop_words) {
             if (!IsValidWord(word)) {
                 throw std::invalid_argument("Stop-words contain special symbols");
             }
-            stop_words_.insert(std::string(word.data(), word.size()));
+            stop_words_.insert(InternWord(word));
         }
     }
 
-    explicit SearchServer(std::string stop_words)
-        :SearchServer(SplitIntoWords(stop_words))
+    explicit SearchServer(std::string stop_words, const SearchServerOptions& options = {})
+        :SearchServer(SplitIntoWords(stop_words), options)
     {
     }
 
-    explicit SearchServer(std::string_view stop_words)
-        :SearchServer(SplitIntoWordsView(stop_words))
+    explicit SearchServer(std::string_view stop_words, const SearchServerOptions& options = {})
+        :SearchServer(SplitIntoWordsView(stop_words), options)
     {
     }
 
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // All or nothing: throws invalid_argument before changing the index if an id is negative,
+    // taken or repeated in the batch, or a text contains special symbols
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<RawDocument>& documents);
+
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents);
+
     template <typename KeyMapper>
-    std::vector<Document> FindTopDocuments(const std::string_view query, KeyMapper key_mapper) const;
+    std::vector<Document> FindTopDocuments(const std::string_view query, KeyMapper key_mapper,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus doc_status) const {
-        return SearchServer::FindTopDocuments(raw_query, [doc_status](int document_id, DocumentStatus status, int rating) { return status == doc_status; });
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus doc_status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return SearchServer::FindTopDocuments(raw_query, StatusFilter{ doc_status }, top_count);
     }
 
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const {
-        return SearchServer::FindTopDocuments(raw_query, [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; });
+        return SearchServer::FindTopDocuments(raw_query, StatusFilter{ DocumentStatus::ACTUAL });
     }
 
     template <typename KeyMapper>
-    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, const std::string_view query, KeyMapper key_mapper) const {
-        return FindTopDocuments(query, key_mapper);
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, const std::string_view query, KeyMapper key_mapper,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocuments(query, key_mapper, top_count);
     }
 
-    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, const std::string_view raw_query, DocumentStatus doc_status) const {
-        return SearchServer::FindTopDocuments(raw_query, [doc_status](int document_id, DocumentStatus status, int rating) { return status == doc_status; });
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, const std::string_view raw_query, DocumentStatus doc_status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return SearchServer::FindTopDocuments(raw_query, StatusFilter{ doc_status }, top_count);
     }
 
     std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, const std::string_view raw_query) const {
-        return SearchServer::FindTopDocuments(raw_query, [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; });
+        return SearchServer::FindTopDocuments(raw_query, StatusFilter{ DocumentStatus::ACTUAL });
     }
 
     template <typename KeyMapper>
-    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, const std::string_view query, KeyMapper key_mapper) const;
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, const std::string_view query, KeyMapper key_mapper,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, const std::string_view raw_query, DocumentStatus doc_status) const {
-        return SearchServer::FindTopDocuments(std::execution::par, raw_query, [doc_status](int document_id, DocumentStatus status, int rating) { return status == doc_status; });
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, const std::string_view raw_query, DocumentStatus doc_status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return SearchServer::FindTopDocuments(std::execution::par, raw_query, StatusFilter{ doc_status }, top_count);
     }
 
     std::vector<Document> FindTopDocuments(std::execution::parallel_policy, const std::string_view raw_query) const {
-        return SearchServer::FindTopDocuments(std::execution::par, raw_query, [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; });
+        return SearchServer::FindTopDocuments(std::execution::par, raw_query, StatusFilter{ DocumentStatus::ACTUAL });
     }
 
     int GetDocumentCount() const;
 
-    set<int>::const_iterator begin() const;
+    DocumentStore::Iterator begin() const;
 
-    set<int>::const_iterator end() const;
+    DocumentStore::Iterator end() const;
 
+    // In MAP mode this is the stored map. Other modes build the map on every call into storage
+    // of the calling thread, valid until its next call; with compressed postings their
+    // frequencies are the quantized ones.
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    IndexMemoryStats GetMemoryStats() const;
+
+    // Changes whenever documents are added or removed. Values are unique across all servers
+    // of the process, so a generation identifies one state of one index.
+    uint64_t GetGeneration() const;
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const;
@@ -107,27 +192,137 @@ public:
 
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+    // Throws out_of_range before removing anything if one of the documents is not indexed.
+    // Every affected posting list is compacted once for the whole batch.
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void RemoveDocuments(const std::execution::sequenced_policy&, const std::vector<int>& document_ids);
+
+    void RemoveDocuments(const std::execution::parallel_policy&, const std::vector<int>& document_ids);
+
+    // Drops the postings of lazily removed documents from the posting lists
+    void CompactPostings();
+
+    void CompactPostings(const std::execution::parallel_policy&);
+
 private:
-    struct DocumentData {
-        int rating;
+    friend void SaveIndex(const SearchServer& search_server, const std::string& path);
+    friend SearchServer LoadIndex(const std::string& path, const SearchServerOptions& options, IndexLoadMode mode);
+    friend class ShardedSearchServer;
+    friend class AsyncSearchServer;
+    friend class QueryCache;
+
+    // Key mapper that only compares the status. Scoring loops recognize it at compile time and
+    // read the status by ordinal, so filtered postings never look up their document.
+    struct StatusFilter {
         DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
+    };
+
+    struct Term {
+        PostingList postings;
+        // log of the number of documents containing the term, kept in sync with postings
+        double log_document_freq = 0.0;
+        // Postings of removed documents that are still in the list
+        size_t removed_postings = 0;
+        std::string_view word;
     };
 
-    std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    SearchServerOptions options_;
+    std::unordered_set<std::string_view> stop_words_;
+    std::unordered_map<std::string_view, size_t> word_to_term_id_;
+    std::vector<Term> terms_;
+    double log_document_count_ = 0.0;
+    // Ordinals of removed documents map to id -1 and are never reused
+    DocumentStore documents_;
+    size_t removed_document_count_ = 0;
+    uint64_t generation_ = NewGeneration();
+    // Forward index in MAP mode
     std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::set<std::string, std::less<>> words_;
+    // Forward index in COMPACT mode: the term ids of ordinal i are
+    // document_term_ids_[document_term_offsets_[i]] .. document_term_ids_[document_term_offsets_[i + 1] - 1]
+    MappableArray<uint32_t> document_term_ids_;
+    MappableArray<uint64_t> document_term_offsets_ = { 0 };
+    // Index keys are views into this storage. Copies of the server share it, so a copy
+    // taken as a snapshot stays valid while the original keeps adding words.
+    struct WordStorage {
+        std::mutex mutex;
+        StringPool words;
+    };
+
+    std::shared_ptr<WordStorage> words_ = std::make_shared<WordStorage>();
+    // Index file loaded as views, kept mapped while the server or a copy of it uses the arrays
+    std::shared_ptr<const MappedFile> mapped_file_;
 
     bool IsStopWord(const std::string_view word) const;
 
+    std::string_view InternWord(const std::string_view word);
+
     static bool IsValidWord(const std::string_view word);
 
     std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
 
+    void CheckNewDocumentIds(const std::vector<RawDocument>& documents) const;
+
+    // Documents of a batch that passed every check, tokenized into sorted words with their
+    // term frequencies. Adding them changes the index without throwing invalid_argument.
+    struct DocumentBatch {
+        const std::vector<RawDocument>* documents = nullptr;
+        std::vector<std::vector<std::pair<std::string_view, double>>> document_words;
+    };
+
+    // Throws invalid_argument like AddDocuments, the index is not changed
+    template <typename ExecutionPolicy>
+    DocumentBatch PrepareDocumentBatch(ExecutionPolicy&& policy, const std::vector<RawDocument>& documents) const;
+
+    template <typename ExecutionPolicy>
+    void AddDocumentBatch(ExecutionPolicy&& policy, const DocumentBatch& batch);
+
+    // For ShardedSearchServer, which prepares the batches of all shards before adding any
+    DocumentBatch PrepareDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents) const;
+
+    void AddPreparedDocuments(const std::execution::parallel_policy&, const DocumentBatch& batch);
+
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    const Term* FindTerm(const std::string_view word) const;
+
+    size_t GetOrAddTermId(const std::string_view word);
+
+    bool ContainsPosting(const std::string_view word, int ordinal) const;
+
+    static void UpdateLogDocumentFreq(Term& term);
+
+    static uint64_t NewGeneration();
+
+    // word_freqs are sorted by word; the words are interned by now
+    template <typename WordFreqs>
+    void AddToForwardIndex(int document_id, const WordFreqs& word_freqs);
+
+    // Term frequency of the document in the list, nullopt if the list does not contain it. A
+    // compressed frequency can decode to 0, so a zero does not mean the posting is missing.
+    static std::optional<double> FindTermFreq(const PostingList& postings, int ordinal);
+
+    // Marks the documents removed and returns the ids of the terms whose lists still hold them
+    std::vector<size_t> MarkDocumentsRemoved(const std::vector<int>& document_ids);
+
+    bool IsRemovedOrdinal(int ordinal) const;
+
+    template <typename KeyMapper>
+    bool IsAcceptedOrdinal(KeyMapper& key_mapper, int ordinal) const;
+
+    template <typename ExecutionPolicy>
+    void CompactTerms(ExecutionPolicy&& policy, std::vector<size_t>& term_ids);
+
+    template <typename ExecutionPolicy>
+    void CompactAllTerms(ExecutionPolicy&& policy);
+
+    template <typename ExecutionPolicy>
+    void RemoveMarkedDocuments(ExecutionPolicy&& policy, std::vector<size_t>& term_ids);
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
@@ -136,154 +331,392 @@ private:
 
     QueryWord ParseQueryWord(const std::string_view text) const;
 
+    // Plus and minus words are sorted and deduplicated. The vectors keep their capacity
+    // between queries, so parsing into a reused Query does not allocate.
     struct Query {
-        std::unordered_set<std::string_view> plus_words;
-        std::unordered_set<std::string_view> minus_words;
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+        // Tokenizer output for the raw query
+        std::vector<std::string_view> words;
+        // IDF of every plus word when it comes from statistics of several indexes,
+        // empty when this index's own statistics apply
+        std::vector<double> plus_word_idfs;
     };
 
-    Query ParseQuery(const std::string_view raw_query) const;
-    Query ParseQueryPar(const std::string_view raw_query) const;
+    // One query per thread, reused across calls like the relevance accumulator
+    static Query& GetThreadQuery();
+
+    void ParseQuery(const std::string_view raw_query, Query& query) const;
+    void ParseQueryPar(const std::string_view raw_query, Query& query) const;
+
+    void AddQueryWords(Query& query) const;
+
+    double ComputeWordInverseDocumentFreq(const Term& term) const;
+
+    double GetInverseDocumentFreq(const Query& query, size_t plus_word_index, const Term& term) const;
+
+    // Number of live documents containing the word
+    size_t GetDocumentFreq(const std::string_view word) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    void UpdateLogDocumentCount();
 
     template <typename KeyMapper>
-    std::vector<Document> FindAllDocuments(const Query& query, KeyMapper key_mapper) const {
-        return FindAllDocuments(std::execution::seq, query, key_mapper);
+    void FindAllDocuments(const Query& query, KeyMapper key_mapper, TopDocuments& top_documents) const {
+        FindAllDocuments(std::execution::seq, query, key_mapper, top_documents);
     }
 
     template <typename KeyMapper>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, Query query,
-        KeyMapper key_mapper) const;
+    void FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+        KeyMapper key_mapper, TopDocuments& top_documents) const;
+
+    template <typename KeyMapper>
+    void FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+        KeyMapper key_mapper, TopDocuments& top_documents) const;
+
+    struct WeightedPostings {
+        const PostingList* postings;
+        double inverse_document_freq;
+    };
+
+    // Term of a max-score evaluation. max_score bounds the relevance the term adds to any document.
+    struct MaxScoreTerm {
+        PostingList::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+    };
+
+    // Reused by the queries of one thread like the relevance accumulator
+    struct MaxScoreState {
+        // In query order, which is the order the exhaustive path sums relevance in
+        std::vector<MaxScoreTerm> terms;
+        // Indexes of terms by ascending max_score
+        std::vector<size_t> order;
+        // bound_prefix[i] is the sum of max_score of the first i terms in that order
+        std::vector<double> bound_prefix;
+    };
+
+    static MaxScoreState& GetThreadMaxScoreState();
+
+    // Above these words the per-document cost of max-score evaluation outweighs the skipping
+    static const size_t MAX_SCORE_MAX_PLUS_WORDS = 8;
+    // Lists of similar length leave nothing to skip, so the longest list must be this many
+    // times longer than the shortest one
+    static const size_t MAX_SCORE_MIN_LENGTH_RATIO = 4;
+
+    bool IsMaxScoreQuery(const Query& query) const;
+
+    // Reused by the query batches of one thread, one accumulator and minus-word set per query
+    struct BatchState {
+        std::vector<RelevanceAccumulator> accumulators;
+        std::vector<OrdinalSet> excluded;
+        // Index of the first query of the batch identical to each query
+        std::vector<size_t> representatives;
+        // Plus words of the scored queries with the index of their query, sorted by word
+        std::vector<std::pair<std::string_view, size_t>> word_queries;
+    };
+
+    static const size_t BATCH_MIN_QUERIES_PER_WORD = 4;
+
+    static BatchState& GetThreadBatchState();
+
+    // Scores every query with its status into its top documents. Identical queries are scored
+    // once. When the rest share enough words they are scored together term-at-a-time, otherwise
+    // every query is scored on its own.
+    void FindAllDocumentsBatch(const std::vector<const Query*>& queries, const std::vector<DocumentStatus>& statuses,
+        std::vector<TopDocuments>& top_documents) const;
+
+    // Words are visited in order across the batch, so the postings of a shared word are walked
+    // once and every query still sums relevance in its own word order like the exhaustive path
+    void FindAllDocumentsTermAtATime(const std::vector<const Query*>& queries, const std::vector<DocumentStatus>& statuses,
+        std::vector<TopDocuments>& top_documents) const;
+
+    // Marks the documents containing any of the minus words
+    void AddMinusWordOrdinals(const Query& query, OrdinalSet& excluded) const;
+
+    template <typename KeyMapper>
+    void FindAllDocumentsByMaxScore(const Query& query, KeyMapper key_mapper, TopDocuments& top_documents) const;
+
+    size_t GetParallelShardCount() const;
 
     template <typename KeyMapper>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, Query query,
-        KeyMapper key_mapper) const;
+    void ScoreOrdinalRange(const std::vector<WeightedPostings>& plus_postings,
+        const std::vector<const PostingList*>& minus_postings, int first_ordinal, int last_ordinal,
+        KeyMapper key_mapper, TopDocuments& top_documents) const;
 };
 
 template <typename KeyMapper>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, Query query,
-    KeyMapper key_mapper) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+void SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+    KeyMapper key_mapper, TopDocuments& top_documents) const {
+    if (IsMaxScoreQuery(query)) {
+        FindAllDocumentsByMaxScore(query, key_mapper, top_documents);
+        return;
+    }
+    OrdinalSet& excluded = GetThreadOrdinalSet(documents_.GetOrdinalCount());
+    AddMinusWordOrdinals(query, excluded);
+    RelevanceAccumulator& accumulator = GetThreadRelevanceAccumulator(documents_.GetOrdinalCount());
+    for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index) {
+        const Term* term = FindTerm(query.plus_words[word_index]);
+        if (term == nullptr || term->postings.empty()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            if (key_mapper(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = GetInverseDocumentFreq(query, word_index, *term);
+        term->postings.ForEach([&](int ordinal, double term_freq) {
+            if (!excluded.Contains(ordinal) && !IsRemovedOrdinal(ordinal) && IsAcceptedOrdinal(key_mapper, ordinal)) {
+                accumulator.Add(ordinal, term_freq * inverse_document_freq);
             }
-        }
+        });
     }
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    for (const int ordinal : accumulator.GetTouched()) {
+        top_documents.Add({
+            documents_.GetDocumentId(ordinal),
+            accumulator.GetRelevance(ordinal),
+            documents_.GetRating(ordinal)
+            });
+    }
+}
+
+template <typename KeyMapper>
+void SearchServer::FindAllDocumentsByMaxScore(const Query& query, KeyMapper key_mapper,
+    TopDocuments& top_documents) const {
+
+    MaxScoreState& state = GetThreadMaxScoreState();
+    std::vector<MaxScoreTerm>& terms = state.terms;
+    terms.clear();
+    for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index) {
+        const Term* term = FindTerm(query.plus_words[word_index]);
+        if (term == nullptr || term->postings.empty()) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
-        }
+        const double inverse_document_freq = GetInverseDocumentFreq(query, word_index, *term);
+        terms.push_back({
+            term->postings.GetCursor(),
+            inverse_document_freq,
+            std::max(0.0, term->postings.GetMaxTermFreq() * inverse_document_freq)
+            });
+    }
+    if (terms.empty() || top_documents.capacity() == 0) {
+        return;
+    }
+    OrdinalSet& excluded = GetThreadOrdinalSet(documents_.GetOrdinalCount());
+    AddMinusWordOrdinals(query, excluded);
+
+    std::vector<size_t>& order = state.order;
+    order.resize(terms.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&terms](size_t lhs, size_t rhs) {
+        return terms[lhs].max_score < terms[rhs].max_score;
+        });
+    std::vector<double>& bound_prefix = state.bound_prefix;
+    bound_prefix.assign(1, 0.0);
+    for (const size_t index : order) {
+        bound_prefix.push_back(bound_prefix.back() + terms[index].max_score);
     }
 
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({
-            document_id,
-            relevance,
-            documents_.at(document_id).rating
-            });
+    // A document matching only terms before first_essential can not beat the threshold, so
+    // candidates come from the other lists and the first ones are only probed for them.
+    // The threshold is lowered by EPSILON because IsMoreRelevant breaks closer ties by rating.
+    double threshold = -std::numeric_limits<double>::infinity();
+    size_t first_essential = 0;
+    for (;;) {
+        int ordinal = INT_MAX;
+        for (size_t i = first_essential; i < order.size(); ++i) {
+            ordinal = std::min(ordinal, terms[order[i]].cursor.GetOrdinal());
+        }
+        if (ordinal == INT_MAX) {
+            break;
+        }
+
+        // Excluded and removed documents are dropped before any scoring or probing
+        bool is_candidate = !excluded.Contains(ordinal) && !IsRemovedOrdinal(ordinal);
+        double score = 0.0;
+        for (size_t i = first_essential; is_candidate && i < order.size(); ++i) {
+            const MaxScoreTerm& term = terms[order[i]];
+            if (term.cursor.GetOrdinal() == ordinal) {
+                score += term.cursor.GetTermFreq() * term.inverse_document_freq;
+            }
+        }
+        for (size_t i = first_essential; is_candidate && i-- > 0;) {
+            if (score + bound_prefix[i + 1] < threshold) {
+                is_candidate = false;
+                break;
+            }
+            MaxScoreTerm& term = terms[order[i]];
+            term.cursor.NextGeq(ordinal);
+            if (term.cursor.GetOrdinal() == ordinal) {
+                score += term.cursor.GetTermFreq() * term.inverse_document_freq;
+            }
+        }
+
+        if (is_candidate && score >= threshold && IsAcceptedOrdinal(key_mapper, ordinal)) {
+            // Every cursor is at or past the document now, so summing in query order
+            // gives exactly the relevance of the exhaustive path
+            double relevance = 0.0;
+            for (const MaxScoreTerm& term : terms) {
+                if (term.cursor.GetOrdinal() == ordinal) {
+                    relevance += term.cursor.GetTermFreq() * term.inverse_document_freq;
+                }
+            }
+            top_documents.Add({ documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal) });
+            if (top_documents.IsFull()) {
+                threshold = top_documents.GetLeastRelevant().relevance - EPSILON;
+                while (first_essential < order.size() && bound_prefix[first_essential + 1] < threshold) {
+                    ++first_essential;
+                }
+            }
+        }
+
+        for (size_t i = first_essential; i < order.size(); ++i) {
+            PostingList::Cursor& cursor = terms[order[i]].cursor;
+            if (cursor.GetOrdinal() == ordinal) {
+                cursor.Next();
+            }
+        }
     }
-    return matched_documents;
 }
 
 template <typename KeyMapper>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, Query query,
-    KeyMapper key_mapper) const {
-
-    ConcurrentMap<int, double> document_to_relevance_mt(100);
-
-    for_each(std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        [&document_to_relevance_mt, this
-        // , &predicate
-        , &query](std::string_view word)
-        {
-            auto contain_minus = std::any_of(std::execution::par,
-                query.minus_words.begin(), query.minus_words.end(),
-                [&query, &word](const auto& minus_word)
-                {
-                    return minus_word == word;
-                });
-
-            if (word_to_document_freqs_.count(word) && !contain_minus) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                std::for_each(std::execution::par,
-                    word_to_document_freqs_.at(std::string(word)).begin(), word_to_document_freqs_.at(std::string(word)).end(),
-                    [this, &document_to_relevance_mt, &inverse_document_freq, &query](const auto& doc_freq)
-                    {
-                        document_to_relevance_mt[doc_freq.first].ref_to_value += doc_freq.second * inverse_document_freq;
-                    });
-            }
-        });
+void SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+    KeyMapper key_mapper, TopDocuments& top_documents) const {
+
+    std::vector<WeightedPostings> plus_postings;
+    for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index) {
+        const Term* term = FindTerm(query.plus_words[word_index]);
+        if (term != nullptr && !term->postings.empty()) {
+            plus_postings.push_back({ &term->postings, GetInverseDocumentFreq(query, word_index, *term) });
+        }
+    }
+    std::vector<const PostingList*> minus_postings;
+    for (std::string_view word : query.minus_words) {
+        const Term* term = FindTerm(word);
+        if (term != nullptr && !term->postings.empty()) {
+            minus_postings.push_back(&term->postings);
+        }
+    }
+    if (plus_postings.empty()) {
+        return;
+    }
 
-    std::atomic_int size = 0;
-    const std::map<int, double>& ord_map = document_to_relevance_mt.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(ord_map.size());
+    // Every shard owns a contiguous range of ordinals, so shards never share an accumulator slot
+    const int ordinal_count = static_cast<int>(documents_.GetOrdinalCount());
+    const size_t shard_count = std::max<size_t>(1, std::min<size_t>(GetParallelShardCount(), ordinal_count));
+    std::vector<TopDocuments> shard_top_documents(shard_count, TopDocuments(top_documents.capacity()));
+    std::vector<size_t> shards(shard_count);
+    std::iota(shards.begin(), shards.end(), 0);
 
     std::for_each(std::execution::par,
-        ord_map.begin(), ord_map.end(),
-        [&matched_documents, this, &size](const auto& map)
-        {
-            int document_id = map.first;
-            double relevance = map.second;
-            matched_documents[size++] = { document_id, relevance, documents_.at(document_id).rating };
+        shards.begin(), shards.end(),
+        [&](size_t shard) {
+            const int first_ordinal = static_cast<int>(ordinal_count * shard / shard_count);
+            const int last_ordinal = static_cast<int>(ordinal_count * (shard + 1) / shard_count);
+            ScoreOrdinalRange(plus_postings, minus_postings, first_ordinal, last_ordinal,
+                key_mapper, shard_top_documents[shard]);
         });
 
-    matched_documents.resize(size);
-
-    return matched_documents;
+    for (TopDocuments& shard_top : shard_top_documents) {
+        for (const Document& document : shard_top.Release()) {
+            top_documents.Add(document);
+        }
+    }
 }
 
 template <typename KeyMapper>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view query, KeyMapper key_mapper) const {
-
-    Query structuredQuery = ParseQuery(query);
-    auto matched_documents = FindAllDocuments(structuredQuery, key_mapper);
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
+void SearchServer::ScoreOrdinalRange(const std::vector<WeightedPostings>& plus_postings,
+    const std::vector<const PostingList*>& minus_postings, int first_ordinal, int last_ordinal,
+    KeyMapper key_mapper, TopDocuments& top_documents) const {
+
+    OrdinalSet& excluded = GetThreadOrdinalSet(last_ordinal);
+    for (const PostingList* postings : minus_postings) {
+        postings->ForEach(first_ordinal, last_ordinal, [&excluded](int ordinal, double) {
+            excluded.Insert(ordinal);
+        });
+    }
+
+    RelevanceAccumulator& accumulator = GetThreadRelevanceAccumulator(last_ordinal);
+    for (const auto [postings, inverse_document_freq] : plus_postings) {
+        postings->ForEach(first_ordinal, last_ordinal, [&](int ordinal, double term_freq) {
+            if (!excluded.Contains(ordinal) && !IsRemovedOrdinal(ordinal) && IsAcceptedOrdinal(key_mapper, ordinal)) {
+                accumulator.Add(ordinal, term_freq * inverse_document_freq);
             }
         });
-    if (matched_documents.size() > unsigned(MAX_RESULT_DOCUMENT_COUNT)) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
-    return matched_documents;
+
+    for (const int ordinal : accumulator.GetTouched()) {
+        top_documents.Add({
+            documents_.GetDocumentId(ordinal),
+            accumulator.GetRelevance(ordinal),
+            documents_.GetRating(ordinal)
+            });
+    }
 }
 
 template <typename KeyMapper>
-std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy, const std::string_view query, KeyMapper key_mapper) const {
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view query, KeyMapper key_mapper,
+    size_t top_count) const {
+
+    Query& structuredQuery = GetThreadQuery();
+    ParseQuery(query, structuredQuery);
+    TopDocuments top_documents(top_count);
+    FindAllDocuments(structuredQuery, key_mapper, top_documents);
+    return top_documents.Release();
+}
 
-    Query structuredQuery = ParseQuery(query);
-    auto matched_documents = FindAllDocuments(std::execution::par, structuredQuery, key_mapper);
+template <typename KeyMapper>
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy, const std::string_view query, KeyMapper key_mapper,
+    size_t top_count) const {
+
+    Query& structuredQuery = GetThreadQuery();
+    ParseQuery(query, structuredQuery);
+    TopDocuments top_documents(top_count);
+    FindAllDocuments(std::execution::par, structuredQuery, key_mapper, top_documents);
+    return top_documents.Release();
+}
 
-    sort(std::execution::par, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
+inline bool SearchServer::IsRemovedOrdinal(int ordinal) const {
+    return documents_.IsRemoved(ordinal);
+}
+
+template <typename KeyMapper>
+bool SearchServer::IsAcceptedOrdinal(KeyMapper& key_mapper, int ordinal) const {
+    if constexpr (std::is_same_v<KeyMapper, StatusFilter>) {
+        return documents_.GetStatus(ordinal) == key_mapper.status;
+    }
+    else {
+        return key_mapper(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal));
+    }
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::CompactTerms(ExecutionPolicy&& policy, std::vector<size_t>& term_ids) {
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    // Every term owns its posting list, so terms are compacted independently
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [this](size_t term_id) {
+        Term& term = terms_[term_id];
+        term.postings.EraseIf([this](int ordinal) { return IsRemovedOrdinal(ordinal); });
+        term.removed_postings = 0;
         });
+}
 
-    if (matched_documents.size() > unsigned(MAX_RESULT_DOCUMENT_COUNT)) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename ExecutionPolicy>
+void SearchServer::RemoveMarkedDocuments(ExecutionPolicy&& policy, std::vector<size_t>& term_ids) {
+    if (!options_.lazy_removal) {
+        CompactTerms(policy, term_ids);
+        removed_document_count_ = 0;
+    }
+    else if (removed_document_count_ * 4 > documents_.size() + removed_document_count_) {
+        CompactAllTerms(policy);
     }
-    return matched_documents;
 }
 
+template <typename ExecutionPolicy>
+void SearchServer::CompactAllTerms(ExecutionPolicy&& policy) {
+    std::vector<size_t> term_ids;
+    for (size_t term_id = 0; term_id < terms_.size(); ++term_id) {
+        if (terms_[term_id].removed_postings > 0) {
+            term_ids.push_back(term_id);
+        }
+    }
+    CompactTerms(policy, term_ids);
+    removed_document_count_ = 0;
+}
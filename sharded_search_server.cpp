@@ -0,0 +1,111 @@
+#include "sharded_search_server.h"
+
+#include <cmath>
+
+using namespace std;
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document,
+    DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("Document_id is negative or already exist"s);
+    }
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    vector<vector<RawDocument>> shard_documents(shards_.size());
+    for (const RawDocument& document : documents) {
+        if (document.id < 0) {
+            throw invalid_argument("Document_id is negative or already exist"s);
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+    // Every shard checks and tokenizes its part before any shard changes, so a bad document
+    // in one part leaves all shards as they were
+    vector<SearchServer::DocumentBatch> shard_batches;
+    shard_batches.reserve(shards_.size());
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        shard_batches.push_back(shards_[shard].PrepareDocuments(execution::par, shard_documents[shard]));
+    }
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (!shard_documents[shard].empty()) {
+            shards_[shard].AddPreparedDocuments(execution::par, shard_batches[shard]);
+        }
+    }
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    RemoveDocuments({ document_id });
+}
+
+void ShardedSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    vector<vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        const size_t shard = GetShardIndex(document_id);
+        if (!shards_[shard].documents_.Contains(document_id)) {
+            throw out_of_range("Document out of range"s);
+        }
+        shard_document_ids[shard].push_back(document_id);
+    }
+    // Every id is known to be indexed, so no shard throws inside the parallel algorithm
+    vector<size_t> shards(shards_.size());
+    iota(shards.begin(), shards.end(), 0);
+    for_each(execution::par, shards.begin(), shards.end(),
+        [&](size_t shard) {
+            if (!shard_document_ids[shard].empty()) {
+                shards_[shard].RemoveDocuments(execution::seq, shard_document_ids[shard]);
+            }
+        });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus doc_status,
+    size_t top_count) const {
+    return FindTopDocuments(raw_query, SearchServer::StatusFilter{ doc_status }, top_count);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(string_view raw_query,
+    int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard) const {
+    return shards_.at(shard);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return static_cast<unsigned>(document_id) % shards_.size();
+}
+
+void ShardedSearchServer::ParseQuery(string_view raw_query, SearchServer::Query& query) const {
+    // All shards share the stop words, so any of them parses the query the same way
+    shards_.front().ParseQuery(raw_query, query);
+
+    // Computed like SearchServer::ComputeWordInverseDocumentFreq, so relevance is
+    // bit-identical to a single server holding every document
+    const int document_count = GetDocumentCount();
+    const double log_document_count = document_count == 0 ? 0.0 : log(static_cast<double>(document_count));
+    for (const string_view word : query.plus_words) {
+        size_t document_freq = 0;
+        for (const SearchServer& shard : shards_) {
+            document_freq += shard.GetDocumentFreq(word);
+        }
+        query.plus_word_idfs.push_back(
+            document_freq == 0 ? 0.0 : log_document_count - log(static_cast<double>(document_freq)));
+    }
+}
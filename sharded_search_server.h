@@ -0,0 +1,100 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Documents are partitioned by id over independent SearchServer shards. A query is parsed
+// once, its IDF comes from the document counts of all shards, and the shards select their
+// top documents in parallel before they are merged. Results match a single server holding
+// every document.
+class ShardedSearchServer {
+public:
+    // shard_count 0 means hardware concurrency
+    template <typename StopWords>
+                                            ShardedSearchServer(const StopWords& stop_words, size_t shard_count,
+        const SearchServerOptions& options = {});
+
+    void                                    AddDocument(int document_id, std::string_view document,
+        DocumentStatus status, const std::vector<int>& ratings);
+
+    // All or nothing across shards: throws invalid_argument before any shard changes if an id
+    // is negative, taken or repeated in the batch, or a text contains special symbols
+    void                                    AddDocuments(const std::vector<RawDocument>& documents);
+
+    void                                    RemoveDocument(int document_id);
+
+    // Throws out_of_range before removing anything if one of the documents is not indexed
+    void                                    RemoveDocuments(const std::vector<int>& document_ids);
+
+    template <typename KeyMapper>
+    std::vector<Document>                   FindTopDocuments(std::string_view raw_query, KeyMapper key_mapper,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>                   FindTopDocuments(std::string_view raw_query, DocumentStatus doc_status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document>                   FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
+        int document_id) const;
+
+    int                                     GetDocumentCount() const;
+
+    size_t                                  GetShardCount() const;
+
+    const SearchServer&                     GetShard(size_t shard) const;
+
+private:
+    std::vector<SearchServer>               shards_;
+
+    size_t                                  GetShardIndex(int document_id) const;
+
+    // Parses the query and fills its IDF from the statistics of all shards
+    void                                    ParseQuery(std::string_view raw_query, SearchServer::Query& query) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(const StopWords& stop_words, size_t shard_count,
+    const SearchServerOptions& options) {
+    if (shard_count == 0) {
+        shard_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Every shard gets its own word storage, so shards never share a lock
+    shards_.reserve(shard_count);
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        shards_.emplace_back(stop_words, options);
+    }
+}
+
+template <typename KeyMapper>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, KeyMapper key_mapper,
+    size_t top_count) const {
+
+    // The query belongs to the calling thread, shards only read it
+    SearchServer::Query& query = SearchServer::GetThreadQuery();
+    ParseQuery(raw_query, query);
+
+    std::vector<TopDocuments> shard_top_documents(shards_.size(), TopDocuments(top_count));
+    std::vector<size_t> shards(shards_.size());
+    std::iota(shards.begin(), shards.end(), 0);
+    std::for_each(std::execution::par,
+        shards.begin(), shards.end(),
+        [&](size_t shard) {
+            shards_[shard].FindAllDocuments(query, key_mapper, shard_top_documents[shard]);
+        });
+
+    TopDocuments top_documents(top_count);
+    for (TopDocuments& shard_top : shard_top_documents) {
+        for (const Document& document : shard_top.Release()) {
+            top_documents.Add(document);
+        }
+    }
+    return top_documents.Release();
+}
@@ -0,0 +1,126 @@
+#include "snapshot_search_server.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+SnapshotSearchServer::SnapshotSearchServer(SearchServer search_server)
+    : published_(make_shared<SearchServer>(move(search_server))) {
+    PublishOwned();
+}
+
+shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const {
+    return atomic_load(&snapshot_);
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, string_view document,
+    DocumentStatus status, const vector<int>& ratings) {
+    lock_guard guard(writer_mutex_);
+    Apply([document_id, text = string(document), status, ratings](SearchServer& search_server) {
+        search_server.AddDocument(document_id, text, status, ratings);
+    });
+}
+
+void SnapshotSearchServer::AddDocuments(const vector<RawDocument>& documents) {
+    lock_guard guard(writer_mutex_);
+    // The log owns the texts; the batch is rebuilt with views into them on every replay
+    vector<string> texts;
+    texts.reserve(documents.size());
+    for (const RawDocument& document : documents) {
+        texts.emplace_back(document.text);
+    }
+    Apply([documents, texts = move(texts)](SearchServer& search_server) {
+        vector<RawDocument> batch = documents;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i].text = texts[i];
+        }
+        search_server.AddDocuments(execution::par, batch);
+    });
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id) {
+    lock_guard guard(writer_mutex_);
+    Apply([document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+void SnapshotSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    lock_guard guard(writer_mutex_);
+    Apply([document_ids](SearchServer& search_server) {
+        search_server.RemoveDocuments(execution::par, document_ids);
+    });
+}
+
+void SnapshotSearchServer::CompactPostings() {
+    lock_guard guard(writer_mutex_);
+    Apply([](SearchServer& search_server) {
+        search_server.CompactPostings(execution::par);
+    });
+}
+
+void SnapshotSearchServer::Publish() {
+    lock_guard guard(writer_mutex_);
+    if (next_generation_) {
+        retired_ = move(published_);
+        retired_is_released_ = move(published_is_released_);
+        retired_changes_ = move(changes_);
+        changes_.clear();
+        published_ = move(next_generation_);
+        PublishOwned();
+    }
+}
+
+void SnapshotSearchServer::PublishOwned() {
+    published_is_released_ = make_shared<atomic<bool>>(false);
+    // Queries of the previous generation keep their pointer, so its deleter runs when they finish
+    const shared_ptr<const SearchServer> snapshot(published_.get(),
+        [search_server = published_, is_released = published_is_released_](const SearchServer*) {
+            is_released->store(true, memory_order_release);
+        });
+    atomic_store(&snapshot_, snapshot);
+}
+
+void SnapshotSearchServer::Apply(Change change) {
+    change(GetNextGeneration());
+    changes_.push_back(move(change));
+}
+
+SearchServer& SnapshotSearchServer::GetNextGeneration() {
+    // Later changes after a publish are applied to the next generation in place
+    if (next_generation_) {
+        return *next_generation_;
+    }
+    if (retired_ && WaitForRetiredReaders()) {
+        // No query reads it any more
+        next_generation_ = move(retired_);
+        for (const Change& change : retired_changes_) {
+            change(*next_generation_);
+        }
+    }
+    else {
+        // Queries still hold it; they free it when they finish
+        retired_ = nullptr;
+        const auto start = chrono::steady_clock::now();
+        next_generation_ = make_shared<SearchServer>(*published_);
+        last_copy_duration_ = chrono::steady_clock::now() - start;
+    }
+    retired_is_released_ = nullptr;
+    retired_changes_.clear();
+    return *next_generation_;
+}
+
+bool SnapshotSearchServer::WaitForRetiredReaders() const {
+    // Queries that took the retired generation before Publish() are finishing; new ones
+    // can not take it, so the wait is bounded by the longest query in flight
+    const auto deadline = chrono::steady_clock::now() + last_copy_duration_;
+    while (!retired_is_released_->load(memory_order_acquire)) {
+        if (chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        this_thread::yield();
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Queries run against an immutable published snapshot of the index. Writers apply
+// changes to a private next generation, which becomes visible to new queries after
+// Publish(). A snapshot is freed once the last query holding it finishes.
+// The generation replaced by Publish() is kept with the changes it lacks. Once no query
+// holds it, the next write replays those changes on it instead of copying the snapshot,
+// so a write costs about its own size rather than the size of the index. The write waits
+// for queries still holding it, but no longer than the last copy took, and copies the
+// snapshot after that. The price is a second copy of the index kept between writes.
+class SnapshotSearchServer {
+public:
+    explicit                                SnapshotSearchServer(SearchServer search_server);
+
+    std::shared_ptr<const SearchServer>     GetSnapshot() const;
+
+    void                                    AddDocument(int document_id, std::string_view document,
+        DocumentStatus status, const std::vector<int>& ratings);
+
+    void                                    AddDocuments(const std::vector<RawDocument>& documents);
+
+    void                                    RemoveDocument(int document_id);
+
+    void                                    RemoveDocuments(const std::vector<int>& document_ids);
+
+    void                                    CompactPostings();
+
+    void                                    Publish();
+
+    template <typename... Args>
+    std::vector<Document>                   FindTopDocuments(Args&&... args) const;
+
+private:
+    using Change = std::function<void(SearchServer&)>;
+
+    // Shares the generation with published_. The last query to release it runs the deleter,
+    // which tells the writer the generation may be modified again.
+    std::shared_ptr<const SearchServer>     snapshot_;
+    std::mutex                              writer_mutex_;
+    // Same generation as snapshot_, owned by the writer
+    std::shared_ptr<SearchServer>           published_;
+    std::shared_ptr<std::atomic<bool>>      published_is_released_;
+    std::shared_ptr<SearchServer>           next_generation_;
+    // Changes made to next_generation_ since it was taken from the snapshot
+    std::vector<Change>                     changes_;
+    // Generation replaced by the last Publish() and the changes that lead from it to the snapshot
+    std::shared_ptr<SearchServer>           retired_;
+    std::shared_ptr<std::atomic<bool>>      retired_is_released_;
+    std::vector<Change>                     retired_changes_;
+    // Zero until the first copy, so the first write never waits
+    std::chrono::steady_clock::duration     last_copy_duration_{};
+
+    SearchServer&                           GetNextGeneration();
+
+    // Publishes the generation owned by published_
+    void                                    PublishOwned();
+
+    // True once no query holds the retired generation, false if that takes longer than a copy
+    bool                                    WaitForRetiredReaders() const;
+
+    // Applies the change to the next generation and logs it. Every SearchServer change checks
+    // its arguments before modifying anything, so a change that throws is not logged.
+    void                                    Apply(Change change);
+};
+
+template <typename... Args>
+std::vector<Document> SnapshotSearchServer::FindTopDocuments(Args&&... args) const {
+    return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+}
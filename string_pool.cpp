@@ -0,0 +1,50 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+string_view StringPool::Intern(string_view str) {
+    const auto it = strings_.find(str);
+    if (it != strings_.end()) {
+        return *it;
+    }
+    char* data = Allocate(str.size());
+    memcpy(data, str.data(), str.size());
+    string_bytes_ += str.size();
+    return *strings_.insert(string_view(data, str.size())).first;
+}
+
+size_t StringPool::GetStringCount() const {
+    return strings_.size();
+}
+
+size_t StringPool::GetStringBytes() const {
+    return string_bytes_;
+}
+
+size_t StringPool::GetMemoryUsage() const {
+    const size_t hash_node_size = sizeof(void*) + sizeof(size_t) + sizeof(string_view);
+    return sizeof(StringPool)
+        + chunk_bytes_
+        + chunks_.capacity() * sizeof(chunks_[0])
+        + strings_.bucket_count() * sizeof(void*)
+        + strings_.size() * hash_node_size;
+}
+
+char* StringPool::Allocate(size_t size) {
+    if (size > chunk_free_) {
+        // A string longer than a chunk gets a chunk of its own; the rest of the current
+        // chunk is abandoned either way
+        const size_t chunk_size = max(size, CHUNK_SIZE);
+        chunks_.push_back(make_unique<char[]>(chunk_size));
+        chunk_bytes_ += chunk_size;
+        chunk_pos_ = chunks_.back().get();
+        chunk_free_ = chunk_size;
+    }
+    char* data = chunk_pos_;
+    chunk_pos_ += size;
+    chunk_free_ -= size;
+    return data;
+}
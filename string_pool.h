@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Append-only storage of distinct strings. Strings are copied back to back into large
+// chunks that are never moved, so returned views stay valid for the pool's lifetime.
+class StringPool {
+public:
+    // Returns a view of the stored copy of str, adding it if it is not in the pool yet
+    std::string_view                        Intern(std::string_view str);
+
+    size_t                                  GetStringCount() const;
+
+    size_t                                  GetStringBytes() const;
+
+    size_t                                  GetMemoryUsage() const;
+
+private:
+    static constexpr size_t                 CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>>    chunks_;
+    char*                                   chunk_pos_ = nullptr;
+    size_t                                  chunk_free_ = 0;
+    size_t                                  chunk_bytes_ = 0;
+    size_t                                  string_bytes_ = 0;
+    std::unordered_set<std::string_view>    strings_;
+
+    char*                                   Allocate(size_t size);
+};
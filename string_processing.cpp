@@ -5,6 +5,10 @@
 
 #include "string_processing.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 vector<string> SplitIntoWords(const string text) {
@@ -28,26 +32,82 @@ vector<string> SplitIntoWords(const string text) {
     return words;
 }
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
-    std::vector<std::string_view> words;
-    std::string_view word = text;
-    size_t startNewWord = 0;
-    for (size_t i = 0; i < text.size(); i++) {
-
-        if (text[i] == ' ') {
-            word.remove_suffix(text.size() - i);
-            if (i != startNewWord)
-            {
-                words.push_back(word);
+namespace {
+
+bool IsControlChar(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+// Scans 16 bytes at a time with SSE2, finding spaces and control characters with two
+// comparisons per block; the tail and other targets use the scalar loop below
+bool SplitWords(string_view text, vector<string_view>& words, bool check_control) {
+    const char* const data = text.data();
+    const size_t size = text.size();
+    size_t pos = 0;
+    size_t word_start = 0;
+    bool in_word = false;
+
+#ifdef __SSE2__
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        if (check_control) {
+            const __m128i control = _mm_and_si128(_mm_cmpgt_epi8(block, minus_one), _mm_cmplt_epi8(block, spaces));
+            if (_mm_movemask_epi8(control) != 0) {
+                return false;
+            }
+        }
+        const unsigned space_mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, spaces)));
+        const unsigned word_mask = ~space_mask & 0xFFFFu;
+        unsigned offset = 0;
+        while (offset < 16) {
+            const unsigned rest = (in_word ? space_mask : word_mask) >> offset;
+            if (rest == 0) {
+                break;
+            }
+            offset += static_cast<unsigned>(__builtin_ctz(rest));
+            if (in_word) {
+                words.push_back(text.substr(word_start, pos + offset - word_start));
             }
-            startNewWord = i + 1;
-            word = text;
-            word.remove_prefix(startNewWord);
+            else {
+                word_start = pos + offset;
+            }
+            in_word = !in_word;
+        }
+    }
+#endif
 
+    for (; pos < size; ++pos) {
+        const char c = data[pos];
+        if (check_control && IsControlChar(c)) {
+            return false;
+        }
+        if (c == ' ') {
+            if (in_word) {
+                words.push_back(text.substr(word_start, pos - word_start));
+                in_word = false;
+            }
+        }
+        else if (!in_word) {
+            word_start = pos;
+            in_word = true;
         }
     }
-    if (!word.empty() && word.at(0) != ' ') {
-        words.push_back(word);
+    if (in_word) {
+        words.push_back(text.substr(word_start));
     }
+    return true;
+}
+
+} // namespace
+
+std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
+    std::vector<std::string_view> words;
+    SplitWords(text, words, false);
     return words;
-}
\ No newline at end of file
+}
+
+bool SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words) {
+    return SplitWords(text, words, true);
+}
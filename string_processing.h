@@ -11,6 +11,10 @@ using namespace std;
 vector<string> SplitIntoWords(string text);
 std::vector<std::string_view> SplitIntoWordsView(std::string_view text);
 
+// Splits text by spaces and checks it for control characters in the same pass.
+// Returns false if a control character is found, words are then incomplete.
+bool SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words);
+
 template <typename StringContainer>
 unordered_set<string_view> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     unordered_set<string_view> non_empty_strings;
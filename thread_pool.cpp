@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t thread_count, size_t queue_capacity)
+    : queue_capacity_(max<size_t>(1, queue_capacity)) {
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+    for (size_t worker = 0; worker < thread_count; ++worker) {
+        workers_.push_back(make_unique<Worker>());
+    }
+    threads_.reserve(thread_count);
+    for (size_t worker = 0; worker < thread_count; ++worker) {
+        threads_.emplace_back([this, worker] { Run(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (thread& worker_thread : threads_) {
+        worker_thread.join();
+    }
+}
+
+void ThreadPool::Submit(function<void()> task) {
+    ReserveSlot();
+    Worker& worker = *workers_[next_worker_.fetch_add(1, memory_order_relaxed) % workers_.size()];
+    {
+        lock_guard worker_guard(worker.mutex);
+        worker.tasks.push_back(move(task));
+    }
+    queued_count_.fetch_add(1);
+    if (sleeping_worker_count_.load() > 0) {
+        // A worker counted as sleeping has either not checked queued_count_ yet or already
+        // waits; passing through mutex_ rules out the moment in between
+        { lock_guard guard(mutex_); }
+        has_tasks_.notify_one();
+    }
+}
+
+void ThreadPool::ReserveSlot() {
+    size_t count = reserved_count_.load();
+    for (;;) {
+        if (count < queue_capacity_) {
+            if (reserved_count_.compare_exchange_weak(count, count + 1)) {
+                return;
+            }
+            continue;
+        }
+        unique_lock lock(mutex_);
+        blocked_producer_count_.fetch_add(1);
+        has_space_.wait(lock, [this] { return reserved_count_.load() < queue_capacity_; });
+        blocked_producer_count_.fetch_sub(1);
+        count = reserved_count_.load();
+    }
+}
+
+void ThreadPool::ReleaseSlot() {
+    queued_count_.fetch_sub(1);
+    reserved_count_.fetch_sub(1);
+    if (blocked_producer_count_.load() > 0) {
+        { lock_guard guard(mutex_); }
+        has_space_.notify_one();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+void ThreadPool::Run(size_t worker) {
+    function<void()> task;
+    for (;;) {
+        if (TryPop(worker, task)) {
+            ReleaseSlot();
+            task();
+            task = nullptr;
+            continue;
+        }
+        unique_lock lock(mutex_);
+        sleeping_worker_count_.fetch_add(1);
+        has_tasks_.wait(lock, [this] { return queued_count_.load() > 0 || is_stopping_; });
+        sleeping_worker_count_.fetch_sub(1);
+        if (queued_count_.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::TryPop(size_t worker, function<void()>& task) {
+    {
+        Worker& own = *workers_[worker];
+        lock_guard guard(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(worker + i) % workers_.size()];
+        lock_guard guard(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that live as long as the pool. Every worker has its own task
+// queue and steals from the back of the others when it runs out. Submit blocks while
+// queue_capacity tasks are waiting, so a fast producer can not queue unbounded work.
+// Submitting and taking a task only lock the deque involved; the pool-wide mutex is taken
+// only by threads going to sleep and by those waking them. Tasks must not throw.
+class ThreadPool {
+public:
+    // thread_count 0 means hardware concurrency
+    explicit                                    ThreadPool(size_t thread_count = 0, size_t queue_capacity = 1024);
+
+                                                ThreadPool(const ThreadPool&) = delete;
+    ThreadPool&                                 operator=(const ThreadPool&) = delete;
+
+    // Runs the tasks that are still queued, then stops the workers
+                                                ~ThreadPool();
+
+    void                                        Submit(std::function<void()> task);
+
+    size_t                                      GetThreadCount() const;
+
+private:
+    struct Worker {
+        std::mutex                              mutex;
+        std::deque<std::function<void()>>       tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>>        workers_;
+    std::vector<std::thread>                    threads_;
+    size_t                                      queue_capacity_;
+    // Slots reserved by Submit, including tasks not pushed yet; bounded by queue_capacity_
+    std::atomic<size_t>                         reserved_count_ = 0;
+    // Tasks in the deques
+    std::atomic<size_t>                         queued_count_ = 0;
+    std::atomic<size_t>                         next_worker_ = 0;
+    // Threads waiting on the condition variables. They are counted under mutex_ before they
+    // check their condition, so the side that changes it only locks mutex_ when someone sleeps.
+    std::atomic<size_t>                         sleeping_worker_count_ = 0;
+    std::atomic<size_t>                         blocked_producer_count_ = 0;
+    std::mutex                                  mutex_;
+    std::condition_variable                     has_tasks_;
+    std::condition_variable                     has_space_;
+    // Guarded by mutex_
+    bool                                        is_stopping_ = false;
+
+    void                                        Run(size_t worker);
+
+    bool                                        TryPop(size_t worker, std::function<void()>& task);
+
+    void                                        ReserveSlot();
+
+    void                                        ReleaseSlot();
+};
@@ -0,0 +1,52 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) < 1e-6) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocuments::TopDocuments(size_t count)
+    : count_(count) {
+    heap_.reserve(count_);
+}
+
+void TopDocuments::Add(const Document& document) {
+    // heap_ keeps the least relevant of the selected documents on top
+    if (heap_.size() < count_) {
+        heap_.push_back(document);
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+    else if (count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+        pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+size_t TopDocuments::size() const {
+    return heap_.size();
+}
+
+size_t TopDocuments::capacity() const {
+    return count_;
+}
+
+bool TopDocuments::IsFull() const {
+    return heap_.size() == count_;
+}
+
+const Document& TopDocuments::GetLeastRelevant() const {
+    return heap_.front();
+}
+
+vector<Document> TopDocuments::Release() {
+    sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return move(heap_);
+}
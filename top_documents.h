@@ -0,0 +1,29 @@
+#pragma once
+
+#include "document.h"
+
+#include <vector>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t count);
+
+    void                    Add(const Document& document);
+
+    size_t                  size() const;
+
+    size_t                  capacity() const;
+
+    bool                    IsFull() const;
+
+    // The document that the next selected one will replace, only valid when the selection is full
+    const Document&         GetLeastRelevant() const;
+
+    std::vector<Document>   Release();
+
+private:
+    size_t                  count_;
+    std::vector<Document>   heap_;
+};